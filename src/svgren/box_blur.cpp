@@ -0,0 +1,768 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "box_blur.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <utki/config.hpp>
+#include <utki/debug.hpp>
+
+#if CFG_CPU == CFG_CPU_X86_64
+#	include <immintrin.h>
+#endif
+
+#if CFG_CPU == CFG_CPU_X86_64 && (CFG_COMPILER == CFG_COMPILER_GCC || CFG_COMPILER == CFG_COMPILER_CLANG)
+#	define SVGREN_BOX_BLUR_AVX2
+#endif
+
+using namespace svgren;
+
+namespace {
+// Box blur of several lines of pixels. A line is a row of an image.
+struct blur_job {
+	const uint8_t* src;
+	uint8_t* dst;
+
+	// distance in bytes between first pixels of consecutive lines
+	ptrdiff_t src_line_stride;
+	ptrdiff_t dst_line_stride;
+
+	unsigned num_lines;
+	unsigned length;
+
+	unsigned box_size;
+	unsigned box_offset;
+
+	// Instead of dividing the sum of pixels by box size, it is multiplied by reciprocal of the box size.
+	// The product is rounded to nearest integer, unlike the former scalar implementation which truncated
+	// the quotient, so blurred pixels can be greater by 1 than before. Truncation would need an exact integer
+	// division in SIMD code, while float multiplication and rounding is exact enough and does not darken
+	// the image. All kernels do exactly same floating point operations, so results do not depend
+	// on the selected instruction set.
+	float scale;
+
+	const uint8_t* src_pixel(unsigned line, unsigned pos) const noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return this->src + ptrdiff_t(line) * this->src_line_stride + ptrdiff_t(pos) * ptrdiff_t(sizeof(image_type::pixel_type));
+	}
+
+	uint8_t* dst_pixel(unsigned line, unsigned pos) const noexcept
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return this->dst + ptrdiff_t(line) * this->dst_line_stride + ptrdiff_t(pos) * ptrdiff_t(sizeof(image_type::pixel_type));
+	}
+
+	// position of the pixel to add to the sum for initial sum calculation
+	unsigned get_initial_pos(unsigned i) const noexcept
+	{
+		using std::clamp;
+		return unsigned(clamp(int(i) - int(this->box_offset), 0, int(this->length) - 1));
+	}
+
+	// position of the pixel to add to the sum after calculating pixel at given position
+	unsigned get_next_pos(unsigned pos) const noexcept
+	{
+		using std::min;
+		return unsigned(min(int(pos) - int(this->box_offset) + int(this->box_size), int(this->length) - 1));
+	}
+
+	// position of the pixel to subtract from the sum after calculating pixel at given position
+	unsigned get_last_pos(unsigned pos) const noexcept
+	{
+		using std::max;
+		return unsigned(max(int(pos) - int(this->box_offset), 0));
+	}
+};
+} // namespace
+
+namespace {
+[[maybe_unused]] void blur_line_generic(const blur_job& job, unsigned line)
+{
+	std::array<uint32_t, 4> sum{};
+
+	auto add = [&](unsigned pos) {
+		auto p = job.src_pixel(line, pos);
+		for (size_t c = 0; c != sum.size(); ++c) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			sum[c] += p[c];
+		}
+	};
+
+	auto subtract = [&](unsigned pos) {
+		auto p = job.src_pixel(line, pos);
+		for (size_t c = 0; c != sum.size(); ++c) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			sum[c] -= p[c];
+		}
+	};
+
+	for (unsigned i = 0; i != job.box_size; ++i) {
+		add(job.get_initial_pos(i));
+	}
+
+	for (unsigned pos = 0; pos != job.length; ++pos) {
+		auto d = job.dst_pixel(line, pos);
+		for (size_t c = 0; c != sum.size(); ++c) {
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+			d[c] = uint8_t(std::lrint(float(sum[c]) * job.scale));
+		}
+
+		add(job.get_next_pos(pos));
+		subtract(job.get_last_pos(pos));
+	}
+}
+} // namespace
+
+#if CFG_CPU == CFG_CPU_X86_64
+
+namespace {
+// load pixel to four 32-bit lanes, one lane per channel
+inline __m128i load_pixel_sse2(const uint8_t* p)
+{
+	int32_t v = 0;
+	std::memcpy(&v, p, sizeof(v));
+
+	auto zero = _mm_setzero_si128();
+	return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+}
+
+inline void store_pixel_sse2(uint8_t* p, __m128i sum, __m128 scale)
+{
+	auto v = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), scale));
+	v = _mm_packs_epi32(v, v);
+	v = _mm_packus_epi16(v, v);
+
+	int32_t r = _mm_cvtsi128_si32(v);
+	std::memcpy(p, &r, sizeof(r));
+}
+} // namespace
+
+namespace {
+// all four channels of the pixel are processed at once
+void blur_line_sse2(const blur_job& job, unsigned line)
+{
+	auto scale = _mm_set1_ps(job.scale);
+
+	auto sum = _mm_setzero_si128();
+
+	for (unsigned i = 0; i != job.box_size; ++i) {
+		sum = _mm_add_epi32(sum, load_pixel_sse2(job.src_pixel(line, job.get_initial_pos(i))));
+	}
+
+	for (unsigned pos = 0; pos != job.length; ++pos) {
+		store_pixel_sse2(job.dst_pixel(line, pos), sum, scale);
+
+		sum = _mm_add_epi32(sum, load_pixel_sse2(job.src_pixel(line, job.get_next_pos(pos))));
+		sum = _mm_sub_epi32(sum, load_pixel_sse2(job.src_pixel(line, job.get_last_pos(pos))));
+	}
+}
+} // namespace
+
+#	ifdef SVGREN_BOX_BLUR_AVX2
+
+namespace {
+// load pixels at given position of two consecutive lines to eight 32-bit lanes,
+// pixel of the first line goes to lower four lanes
+__attribute__((target("avx2"))) inline __m256i load_pixels_avx2(const blur_job& job, unsigned line, unsigned pos)
+{
+	int32_t v0 = 0;
+	int32_t v1 = 0;
+	std::memcpy(&v0, job.src_pixel(line, pos), sizeof(v0));
+	std::memcpy(&v1, job.src_pixel(line + 1, pos), sizeof(v1));
+
+	return _mm256_cvtepu8_epi32(_mm_unpacklo_epi32(_mm_cvtsi32_si128(v0), _mm_cvtsi32_si128(v1)));
+}
+
+__attribute__((target("avx2"))) inline void store_pixels_avx2(uint8_t* p0, uint8_t* p1, __m256i sum, __m256 scale)
+{
+	auto v = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale));
+
+	// packing works within 128-bit halves, so first pixel ends up in lower half and second one in upper half
+	v = _mm256_packs_epi32(v, v);
+	v = _mm256_packus_epi16(v, v);
+
+	int32_t r0 = _mm_cvtsi128_si32(_mm256_castsi256_si128(v));
+	int32_t r1 = _mm_cvtsi128_si32(_mm256_extracti128_si256(v, 1));
+	std::memcpy(p0, &r0, sizeof(r0));
+	std::memcpy(p1, &r1, sizeof(r1));
+}
+} // namespace
+
+namespace {
+// two lines are processed at once, all four channels of the pixels at once
+__attribute__((target("avx2"))) void blur_line_pair_avx2(const blur_job& job, unsigned line)
+{
+	auto scale = _mm256_set1_ps(job.scale);
+
+	auto sum = _mm256_setzero_si256();
+
+	for (unsigned i = 0; i != job.box_size; ++i) {
+		sum = _mm256_add_epi32(sum, load_pixels_avx2(job, line, job.get_initial_pos(i)));
+	}
+
+	for (unsigned pos = 0; pos != job.length; ++pos) {
+		store_pixels_avx2(job.dst_pixel(line, pos), job.dst_pixel(line + 1, pos), sum, scale);
+
+		sum = _mm256_add_epi32(sum, load_pixels_avx2(job, line, job.get_next_pos(pos)));
+		sum = _mm256_sub_epi32(sum, load_pixels_avx2(job, line, job.get_last_pos(pos)));
+	}
+}
+} // namespace
+
+#	endif // ~SVGREN_BOX_BLUR_AVX2
+
+#endif // ~CFG_CPU_X86_64
+
+namespace {
+using blur_lines_type = void (*)(const blur_job& job, const cancellation_token& cancellation);
+
+void blur_lines_generic(const blur_job& job, const cancellation_token& cancellation)
+{
+	for (unsigned l = 0; l != job.num_lines; ++l) {
+		cancellation.check();
+		blur_line_generic(job, l);
+	}
+}
+
+#if CFG_CPU == CFG_CPU_X86_64
+void blur_lines_sse2(const blur_job& job, const cancellation_token& cancellation)
+{
+	for (unsigned l = 0; l != job.num_lines; ++l) {
+		cancellation.check();
+		blur_line_sse2(job, l);
+	}
+}
+#endif
+
+#ifdef SVGREN_BOX_BLUR_AVX2
+void blur_lines_avx2(const blur_job& job, const cancellation_token& cancellation)
+{
+	unsigned l = 0;
+	for (; l + 1 < job.num_lines; l += 2) {
+		cancellation.check();
+		blur_line_pair_avx2(job, l);
+	}
+
+	// odd line left
+	if (l != job.num_lines) {
+		cancellation.check();
+		blur_line_sse2(job, l);
+	}
+}
+#endif
+
+blur_lines_type get_blur_lines(box_blur_kernel kernel)
+{
+	switch (kernel) {
+		case box_blur_kernel::automatic:
+			break;
+		case box_blur_kernel::generic:
+			return &blur_lines_generic;
+#if CFG_CPU == CFG_CPU_X86_64
+		case box_blur_kernel::sse2:
+			return &blur_lines_sse2;
+#endif
+#ifdef SVGREN_BOX_BLUR_AVX2
+		case box_blur_kernel::avx2:
+			if (__builtin_cpu_supports("avx2")) {
+				return &blur_lines_avx2;
+			}
+			break;
+#endif
+		default:
+			break;
+	}
+
+	ASSERT(kernel == box_blur_kernel::automatic)
+
+#ifdef SVGREN_BOX_BLUR_AVX2
+	if (__builtin_cpu_supports("avx2")) {
+		return &blur_lines_avx2;
+	}
+#endif
+
+#if CFG_CPU == CFG_CPU_X86_64
+	// SSE2 is always supported by x86_64 CPUs
+	return &blur_lines_sse2;
+#else
+	return &blur_lines_generic;
+#endif
+}
+
+void blur_lines(const blur_job& job, const cancellation_token& cancellation, box_blur_kernel kernel)
+{
+	if (kernel != box_blur_kernel::automatic) {
+		get_blur_lines(kernel)(job, cancellation);
+		return;
+	}
+
+	// select kernel once, on first use
+	static const blur_lines_type automatic_kernel = get_blur_lines(box_blur_kernel::automatic);
+
+	automatic_kernel(job, cancellation);
+}
+} // namespace
+
+// The vertical pass walks the image row by row and keeps running sums of a block of columns.
+// This way memory is accessed contiguously instead of striding a whole row for each pixel.
+// Sums are kept per channel value, i.e. there are 4 sums per pixel.
+namespace {
+constexpr unsigned num_channels = sizeof(image_type::pixel_type) / sizeof(image_type::pixel_type::value_type);
+
+// Width of the column block in pixels. Sums for the block take 16 KiB, so these stay in L1 cache.
+constexpr unsigned column_block_width = 1024;
+
+struct column_kernel {
+	// sum[i] += src[i]
+	void (*add)(uint32_t* sum, const uint8_t* src, size_t n);
+
+	// sum[i] += add[i] - sub[i]
+	void (*add_sub)(uint32_t* sum, const uint8_t* add, const uint8_t* sub, size_t n);
+
+	// dst[i] = round(sum[i] * scale)
+	void (*store)(uint8_t* dst, const uint32_t* sum, float scale, size_t n);
+};
+
+const uint8_t* as_bytes(const image_type::pixel_type* p)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	return reinterpret_cast<const uint8_t*>(p);
+}
+
+uint8_t* as_bytes(image_type::pixel_type* p)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	return reinterpret_cast<uint8_t*>(p);
+}
+} // namespace
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+namespace {
+void column_add_generic(uint32_t* sum, const uint8_t* src, size_t n)
+{
+	for (size_t i = 0; i != n; ++i) {
+		sum[i] += src[i];
+	}
+}
+
+void column_add_sub_generic(uint32_t* sum, const uint8_t* add, const uint8_t* sub, size_t n)
+{
+	for (size_t i = 0; i != n; ++i) {
+		sum[i] += add[i];
+		sum[i] -= sub[i];
+	}
+}
+
+void column_store_generic(uint8_t* dst, const uint32_t* sum, float scale, size_t n)
+{
+	for (size_t i = 0; i != n; ++i) {
+		dst[i] = uint8_t(std::lrint(float(sum[i]) * scale));
+	}
+}
+} // namespace
+
+#if CFG_CPU == CFG_CPU_X86_64
+
+namespace {
+// 16 channel values are processed at once, the rest is processed by generic kernel
+
+// 16 bytes widened to 32-bit values
+struct widened_sse2 {
+	__m128i v0;
+	__m128i v1;
+	__m128i v2;
+	__m128i v3;
+};
+
+inline widened_sse2 widen_sse2(const uint8_t* p)
+{
+	auto zero = _mm_setzero_si128();
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+	auto lo = _mm_unpacklo_epi8(v, zero);
+	auto hi = _mm_unpackhi_epi8(v, zero);
+
+	return {
+		_mm_unpacklo_epi16(lo, zero), //
+		_mm_unpackhi_epi16(lo, zero),
+		_mm_unpacklo_epi16(hi, zero),
+		_mm_unpackhi_epi16(hi, zero)
+	};
+}
+
+// sum[i] += add[i] - sub[i] for 4 values
+inline void add_sub_sse2(uint32_t* sum, __m128i add, __m128i sub)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto p = reinterpret_cast<__m128i*>(sum);
+	_mm_storeu_si128(p, _mm_sub_epi32(_mm_add_epi32(_mm_loadu_si128(p), add), sub));
+}
+
+void column_add_sse2(uint32_t* sum, const uint8_t* src, size_t n)
+{
+	auto zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		auto a = widen_sse2(src + i);
+		add_sub_sse2(sum + i, a.v0, zero);
+		add_sub_sse2(sum + i + 4, a.v1, zero);
+		add_sub_sse2(sum + i + 8, a.v2, zero);
+		add_sub_sse2(sum + i + 12, a.v3, zero);
+	}
+	column_add_generic(sum + i, src + i, n - i);
+}
+
+void column_add_sub_sse2(uint32_t* sum, const uint8_t* add, const uint8_t* sub, size_t n)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		auto a = widen_sse2(add + i);
+		auto s = widen_sse2(sub + i);
+		add_sub_sse2(sum + i, a.v0, s.v0);
+		add_sub_sse2(sum + i + 4, a.v1, s.v1);
+		add_sub_sse2(sum + i + 8, a.v2, s.v2);
+		add_sub_sse2(sum + i + 12, a.v3, s.v3);
+	}
+	column_add_sub_generic(sum + i, add + i, sub + i, n - i);
+}
+
+void column_store_sse2(uint8_t* dst, const uint32_t* sum, float scale, size_t n)
+{
+	auto s = _mm_set1_ps(scale);
+
+	auto load = [&](const uint32_t* p) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		return _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(v), s));
+	};
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		auto lo = _mm_packs_epi32(load(sum + i), load(sum + i + 4));
+		auto hi = _mm_packs_epi32(load(sum + i + 8), load(sum + i + 12));
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	column_store_generic(dst + i, sum + i, scale, n - i);
+}
+} // namespace
+
+#	ifdef SVGREN_BOX_BLUR_AVX2
+
+namespace {
+// 16 channel values are processed at once, the rest is processed by generic kernel
+
+// 16 bytes widened to 32-bit values
+struct widened_avx2 {
+	__m256i v0;
+	__m256i v1;
+};
+
+__attribute__((target("avx2"))) inline widened_avx2 widen_avx2(const uint8_t* p)
+{
+	// NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+	return {
+		_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))), //
+		_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 8)))
+	};
+	// NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+// sum[i] += add[i] - sub[i] for 8 values
+__attribute__((target("avx2"))) inline void add_sub_avx2(uint32_t* sum, __m256i add, __m256i sub)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto p = reinterpret_cast<__m256i*>(sum);
+	_mm256_storeu_si256(p, _mm256_sub_epi32(_mm256_add_epi32(_mm256_loadu_si256(p), add), sub));
+}
+
+__attribute__((target("avx2"))) void column_add_avx2(uint32_t* sum, const uint8_t* src, size_t n)
+{
+	auto zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		auto a = widen_avx2(src + i);
+		add_sub_avx2(sum + i, a.v0, zero);
+		add_sub_avx2(sum + i + 8, a.v1, zero);
+	}
+	column_add_generic(sum + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) void column_add_sub_avx2(
+	uint32_t* sum, //
+	const uint8_t* add,
+	const uint8_t* sub,
+	size_t n
+)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		auto a = widen_avx2(add + i);
+		auto s = widen_avx2(sub + i);
+		add_sub_avx2(sum + i, a.v0, s.v0);
+		add_sub_avx2(sum + i + 8, a.v1, s.v1);
+	}
+	column_add_sub_generic(sum + i, add + i, sub + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline __m256i scale_avx2(const uint32_t* p, __m256 scale)
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	return _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+}
+
+__attribute__((target("avx2"))) void column_store_avx2(uint8_t* dst, const uint32_t* sum, float scale, size_t n)
+{
+	auto s = _mm256_set1_ps(scale);
+
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		// packing works within 128-bit halves, so restore the order of 64-bit quarters afterwards
+		auto v = _mm256_packs_epi32(scale_avx2(sum + i, s), scale_avx2(sum + i + 8, s));
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		v = _mm256_permute4x64_epi64(v, 0xd8);
+		auto r = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+	}
+	column_store_generic(dst + i, sum + i, scale, n - i);
+}
+} // namespace
+
+#	endif // ~SVGREN_BOX_BLUR_AVX2
+
+#endif // ~CFG_CPU_X86_64
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+namespace {
+column_kernel get_column_kernel(box_blur_kernel kernel)
+{
+	switch (kernel) {
+		case box_blur_kernel::automatic:
+			break;
+		case box_blur_kernel::generic:
+			return {&column_add_generic, &column_add_sub_generic, &column_store_generic};
+#if CFG_CPU == CFG_CPU_X86_64
+		case box_blur_kernel::sse2:
+			return {&column_add_sse2, &column_add_sub_sse2, &column_store_sse2};
+#endif
+#ifdef SVGREN_BOX_BLUR_AVX2
+		case box_blur_kernel::avx2:
+			if (__builtin_cpu_supports("avx2")) {
+				return {&column_add_avx2, &column_add_sub_avx2, &column_store_avx2};
+			}
+			break;
+#endif
+		default:
+			break;
+	}
+
+	ASSERT(kernel == box_blur_kernel::automatic)
+
+	// select kernel once, on first use
+	static const column_kernel automatic_kernel = []() -> column_kernel {
+#ifdef SVGREN_BOX_BLUR_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			return {&column_add_avx2, &column_add_sub_avx2, &column_store_avx2};
+		}
+#endif
+
+#if CFG_CPU == CFG_CPU_X86_64
+		return {&column_add_sse2, &column_add_sub_sse2, &column_store_sse2};
+#else
+		return {&column_add_generic, &column_add_sub_generic, &column_store_generic};
+#endif
+	}();
+
+	return automatic_kernel;
+}
+} // namespace
+
+bool svgren::is_supported(box_blur_kernel kernel)
+{
+	switch (kernel) {
+		case box_blur_kernel::automatic:
+		case box_blur_kernel::generic:
+			return true;
+		case box_blur_kernel::sse2:
+			return CFG_CPU == CFG_CPU_X86_64;
+		case box_blur_kernel::avx2:
+#ifdef SVGREN_BOX_BLUR_AVX2
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+namespace {
+template <typename span_type>
+ptrdiff_t get_row_stride(const span_type& span)
+{
+	if (span.dims().y() < 2) {
+		return 0;
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	return reinterpret_cast<const uint8_t*>(span[1].data()) - reinterpret_cast<const uint8_t*>(span[0].data());
+}
+} // namespace
+
+namespace {
+blur_job make_blur_job(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	unsigned box_size,
+	unsigned box_offset
+)
+{
+	const auto& dims = src.dims();
+
+	blur_job job{};
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	job.src = reinterpret_cast<const uint8_t*>(src[0].data());
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	job.dst = reinterpret_cast<uint8_t*>(dst[0].data());
+	job.src_line_stride = get_row_stride(src);
+	job.dst_line_stride = get_row_stride(dst);
+	job.num_lines = dims.y();
+	job.length = dims.x();
+	job.box_size = box_size;
+	job.box_offset = box_offset;
+	job.scale = 1.0f / float(box_size);
+
+	return job;
+}
+} // namespace
+
+void svgren::box_blur_horizontal(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	unsigned box_size,
+	unsigned box_offset,
+	const cancellation_token& cancellation,
+	box_blur_kernel kernel
+)
+{
+	ASSERT(dst.dims() == src.dims())
+
+	if (box_size == 0 || src.dims().is_any_zero()) {
+		return;
+	}
+
+	if (!is_supported(kernel)) {
+		throw std::invalid_argument("box_blur_horizontal(): kernel is not supported");
+	}
+
+	blur_lines(make_blur_job(dst, src, box_size, box_offset), cancellation, kernel);
+}
+
+void svgren::box_blur_vertical(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	unsigned box_size,
+	unsigned box_offset,
+	const cancellation_token& cancellation,
+	box_blur_kernel kernel
+)
+{
+	ASSERT(dst.dims() == src.dims())
+
+	if (box_size == 0 || src.dims().is_any_zero()) {
+		return;
+	}
+
+	if (!is_supported(kernel)) {
+		throw std::invalid_argument("box_blur_vertical(): kernel is not supported");
+	}
+
+	const auto& dims = src.dims();
+
+	const auto column = get_column_kernel(kernel);
+
+	float scale = 1.0f / float(box_size);
+
+	auto get_row = [](auto span, unsigned y, unsigned x) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return span[y].data() + x;
+	};
+
+	// the position calculations are same as for horizontal blur, see blur_job
+	auto get_initial_y = [&](unsigned i) {
+		using std::clamp;
+		return unsigned(clamp(int(i) - int(box_offset), 0, int(dims.y()) - 1));
+	};
+	auto get_next_y = [&](unsigned y) {
+		using std::min;
+		return unsigned(min(int(y) - int(box_offset) + int(box_size), int(dims.y()) - 1));
+	};
+	auto get_last_y = [&](unsigned y) {
+		using std::max;
+		return unsigned(max(int(y) - int(box_offset), 0));
+	};
+
+	using std::min;
+	std::vector<uint32_t> sum(size_t(min(dims.x(), column_block_width)) * num_channels);
+
+	for (unsigned x = 0; x < dims.x(); x += column_block_width) {
+		size_t n = size_t(min(dims.x() - x, column_block_width)) * num_channels;
+
+		std::fill(sum.begin(), sum.end(), 0);
+
+		for (unsigned i = 0; i != box_size; ++i) {
+			column.add(sum.data(), as_bytes(get_row(src, get_initial_y(i), x)), n);
+		}
+
+		for (unsigned y = 0; y != dims.y(); ++y) {
+			cancellation.check();
+
+			column.store(as_bytes(get_row(dst, y, x)), sum.data(), scale, n);
+
+			column.add_sub(
+				sum.data(), //
+				as_bytes(get_row(src, get_next_y(y), x)),
+				as_bytes(get_row(src, get_last_y(y), x)),
+				n
+			);
+		}
+	}
+}
@@ -0,0 +1,97 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include "cancellation_token.hxx"
+#include "config.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Implementation of the box blur kernels.
+ * Normally the fastest implementation supported by the CPU is selected automatically.
+ * Selecting a particular implementation is for checking that all of them give same results.
+ */
+enum class box_blur_kernel {
+	automatic,
+	generic,
+	sse2,
+	avx2
+};
+
+/**
+ * @brief Check if the box blur kernel implementation can be used.
+ * @param kernel - kernel implementation.
+ * @return true if the kernel is built in and supported by the CPU.
+ */
+bool is_supported(box_blur_kernel kernel);
+
+/**
+ * @brief Box blur image horizontally.
+ * Each destination pixel is the average of box_size source pixels of the same row,
+ * starting from box_offset pixels to the left, rounded to nearest integer.
+ * Pixels outside of the image are taken from the image edge.
+ * The kernel uses SIMD instructions, the instruction set is selected at runtime according to CPU capabilities.
+ * @param dst - destination image.
+ * @param src - source image, must be of same dimensions as destination image.
+ * @param box_size - box size in pixels. Zero box size means nothing is done.
+ * @param box_offset - box offset in pixels.
+ * @param cancellation - cancellation token to check after each row.
+ * @param kernel - kernel implementation to use, must be supported, see is_supported().
+ */
+void box_blur_horizontal(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	unsigned box_size,
+	unsigned box_offset,
+	const cancellation_token& cancellation,
+	box_blur_kernel kernel = box_blur_kernel::automatic
+);
+
+/**
+ * @brief Box blur image vertically.
+ * Same as box_blur_horizontal(), but averages pixels of a column.
+ * The image is processed in blocks of columns, walking the rows of a block from top to bottom,
+ * so that memory is accessed row-contiguously.
+ * @param dst - destination image.
+ * @param src - source image, must be of same dimensions as destination image.
+ * @param box_size - box size in pixels. Zero box size means nothing is done.
+ * @param box_offset - box offset in pixels.
+ * @param cancellation - cancellation token to check after each row of a column block.
+ * @param kernel - kernel implementation to use, must be supported, see is_supported().
+ */
+void box_blur_vertical(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	unsigned box_size,
+	unsigned box_offset,
+	const cancellation_token& cancellation,
+	box_blur_kernel kernel = box_blur_kernel::automatic
+);
+
+} // namespace svgren
@@ -0,0 +1,60 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include "render.hpp"
+
+namespace svgren {
+
+/**
+ * @brief Cancellation state of a rasterization.
+ * Long running parts of the rasterization call check() regularly,
+ * so that the rasterization can be aborted in a timely manner.
+ */
+class cancellation_token
+{
+	const std::atomic_bool* cancel_flag = nullptr;
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+public:
+	cancellation_token() = default;
+
+	cancellation_token(const parameters& params) :
+		cancel_flag(params.cancel_flag),
+		deadline(params.deadline)
+	{}
+
+	/**
+	 * @brief Check if rasterization has to be aborted.
+	 * @throw svgren::canceled - in case the cancel flag is set.
+	 * @throw svgren::deadline_exceeded - in case the deadline has passed.
+	 */
+	void check() const;
+};
+
+} // namespace svgren
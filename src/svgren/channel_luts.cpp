@@ -0,0 +1,109 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "channel_luts.hxx"
+
+#include <algorithm>
+
+#include <utki/debug.hpp>
+
+using namespace svgren;
+
+namespace {
+constexpr unsigned num_channels = sizeof(image_type::pixel_type) / sizeof(image_type::pixel_type::value_type);
+
+constexpr unsigned alpha_channel = num_channels - 1;
+} // namespace
+
+void channel_luts::set(unsigned channel, const std::function<float(unsigned)>& func)
+{
+	ASSERT(channel < this->tables.size())
+
+	auto& table = this->tables[channel];
+
+	for (unsigned v = 0; v != table.size(); ++v) {
+		using std::clamp;
+		auto c = clamp(func(v), 0.0f, 1.0f);
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		table[v] = uint16_t(c * float(one) + 0.5f);
+	}
+}
+
+namespace {
+// Reciprocals of alpha values multiplied by 255, in fixed-point format.
+// Multiplying premultiplied color value by the reciprocal gives unpremultiplied value.
+// The reciprocals are rounded up, so that exact halves are rounded up when unpremultiplying,
+// and the precision is enough for other values to be rounded to nearest correctly.
+constexpr unsigned reciprocal_fraction_bits = 24;
+
+using reciprocals_type = std::array<uint64_t, 0x100>;
+
+const reciprocals_type& get_alpha_reciprocals()
+{
+	static const reciprocals_type reciprocals = []() {
+		reciprocals_type ret{};
+		// reciprocal of alpha 0 stays 0, color channels of such pixels are 0 anyway
+		for (unsigned a = 1; a != ret.size(); ++a) {
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			ret[a] = ((uint64_t(0xff) << reciprocal_fraction_bits) + a - 1) / a;
+		}
+		return ret;
+	}();
+	return reciprocals;
+}
+} // namespace
+
+void channel_luts::apply(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src) const
+{
+	ASSERT(dst.size() == src.size())
+
+	const auto& reciprocals = get_alpha_reciprocals();
+
+	auto dp = dst.begin();
+	for (const auto& px : src) {
+		using std::min;
+
+		auto r = reciprocals[px.a()];
+		uint32_t a = this->tables[alpha_channel][px.a()];
+
+		image_type::pixel_type res;
+		for (unsigned i = 0; i != alpha_channel; ++i) {
+			// unpremultiply
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			auto v = (px[i] * r + (uint64_t(1) << (reciprocal_fraction_bits - 1))) >> reciprocal_fraction_bits;
+			v = min(v, uint64_t(0xff));
+
+			// premultiply with rounding, the product of color and alpha from lookup tables fits into 32 bits
+			constexpr uint32_t divisor = one * scale;
+			res[i] = uint8_t((this->tables[i][v] * a + divisor / 2) / divisor);
+		}
+		res.a() = uint8_t((a + scale / 2) / scale);
+
+		*dp = res;
+		++dp;
+	}
+}
@@ -0,0 +1,79 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+
+#include <utki/span.hpp>
+
+#include "config.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Per-channel lookup tables for premultiplied pixels.
+ * Each resulting channel is a function of the same channel of the source pixel, e.g. diagonal
+ * color matrix or component transfer. The functions are defined for unpremultiplied values,
+ * the unpremultiplying and premultiplying are done in integer arithmetic when the tables are applied,
+ * so that no floating point operations are done per pixel.
+ */
+class channel_luts
+{
+public:
+	/**
+	 * @brief Precision of the lookup table values.
+	 * The values have 8 more bits of precision than 8-bit channel values, so the value of 1 is 0xff00.
+	 */
+	constexpr static uint32_t scale = 0x100;
+	constexpr static uint32_t one = 0xff * scale;
+
+private:
+	// for each channel, resulting unpremultiplied value for each unpremultiplied source value,
+	// alpha channel is the last one
+	std::array<std::array<uint16_t, 0x100>, 4> tables{};
+
+public:
+	/**
+	 * @brief Set function of the channel.
+	 * @param channel - channel index, 3 is alpha.
+	 * @param func - function which gives resulting value for a source value from [0, 255].
+	 *               The resulting value is clamped to [0, 1].
+	 */
+	void set(unsigned channel, const std::function<float(unsigned)>& func);
+
+	/**
+	 * @brief Apply the lookup tables to a row of pixels.
+	 * @param dst - destination pixels.
+	 * @param src - source pixels, must be of same size as destination.
+	 *              Can be the same pixels as the destination, then the tables are applied in place.
+	 */
+	void apply(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src) const;
+};
+
+} // namespace svgren
@@ -0,0 +1,333 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+/* ================ LICENSE END ================ */
+
+#include "color_matrix.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#include <utki/config.hpp>
+#include <utki/debug.hpp>
+
+#if CFG_CPU == CFG_CPU_X86_64
+#	include <immintrin.h>
+#endif
+
+using namespace svgren;
+
+namespace {
+constexpr unsigned num_channels = sizeof(image_type::pixel_type) / sizeof(image_type::pixel_type::value_type);
+
+constexpr unsigned alpha_channel = num_channels - 1;
+
+constexpr float channel_max = 0xff;
+
+// matrix elements which differ from 0 or 1 by less than this are considered to be exactly 0 or 1,
+// this is to detect identity matrices resulting from e.g. hueRotate by 0 degrees
+constexpr float epsilon = 1e-5f;
+} // namespace
+
+namespace {
+bool is_zero(float v)
+{
+	using std::abs;
+	return abs(v) < epsilon;
+}
+
+bool is_one(float v)
+{
+	return is_zero(v - 1);
+}
+} // namespace
+
+color_matrix_kernel::color_matrix_kernel(const r4::matrix4<real>& m, const r4::vector4<real>& mc5)
+{
+	for (unsigned i = 0; i != num_channels; ++i) {
+		for (unsigned j = 0; j != num_channels; ++j) {
+			this->columns[j][i] = float(m[i][j]);
+		}
+		this->offset[i] = float(mc5[i]);
+	}
+
+	bool is_diagonal = true;
+	bool is_identity = true;
+	bool is_alpha_only = true;
+
+	for (unsigned i = 0; i != num_channels; ++i) {
+		for (unsigned j = 0; j != num_channels; ++j) {
+			auto v = this->columns[j][i];
+			if (i == j) {
+				is_identity = is_identity && is_one(v);
+			} else {
+				is_diagonal = is_diagonal && is_zero(v);
+			}
+			if (i != alpha_channel) {
+				is_alpha_only = is_alpha_only && is_zero(v);
+			}
+		}
+
+		is_identity = is_identity && is_zero(this->offset[i]);
+		if (i != alpha_channel) {
+			is_alpha_only = is_alpha_only && is_zero(this->offset[i]);
+		}
+	}
+
+	if (is_diagonal && is_identity) {
+		this->matrix_kind = kind::identity;
+	} else if (is_alpha_only) {
+		this->matrix_kind = kind::alpha_only;
+	} else if (is_diagonal) {
+		this->matrix_kind = kind::diagonal;
+
+		for (unsigned i = 0; i != num_channels; ++i) {
+			this->luts.set(i, [&](unsigned v) {
+				return this->columns[i][i] * float(v) / channel_max + this->offset[i];
+			});
+		}
+	} else {
+		this->matrix_kind = kind::general;
+	}
+}
+
+void color_matrix_kernel::apply(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src)
+	const
+{
+	ASSERT(dst.size() == src.size())
+
+	switch (this->matrix_kind) {
+		case kind::identity:
+			if (dst.data() != src.data()) {
+				std::copy(src.begin(), src.end(), dst.begin());
+			}
+			break;
+		case kind::alpha_only:
+			this->apply_alpha_only(dst, src);
+			break;
+		case kind::diagonal:
+			this->luts.apply(dst, src);
+			break;
+		case kind::general:
+			this->apply_general(dst, src);
+			break;
+	}
+}
+
+namespace {
+// divisor of color channel to unpremultiply it, alpha of 0 is replaced with 1,
+// since color channels of such pixel are 0 anyway and so the unpremultiplied color is black
+float get_unpremultiply_divisor(image_type::pixel_type::value_type alpha)
+{
+	using std::max;
+	return max(float(alpha), 1.0f);
+}
+} // namespace
+
+void color_matrix_kernel::apply_alpha_only(
+	utki::span<image_type::pixel_type> dst, //
+	utki::span<const image_type::pixel_type> src
+) const
+{
+	const auto& c = this->columns;
+
+	auto dp = dst.begin();
+	for (const auto& px : src) {
+		using std::clamp;
+
+		auto d = get_unpremultiply_divisor(px.a());
+
+		auto a = c[0][alpha_channel] * (float(px.r()) / d) + c[1][alpha_channel] * (float(px.g()) / d) +
+			c[2][alpha_channel] * (float(px.b()) / d) + c[alpha_channel][alpha_channel] * (float(px.a()) / channel_max) +
+			this->offset[alpha_channel];
+
+		// resulting color is black, so premultiplied color channels are 0
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		*dp = {0, 0, 0, uint8_t(clamp(a, 0.0f, 1.0f) * channel_max + 0.5f)};
+		++dp;
+	}
+}
+
+namespace {
+// Result of the general matrix for a single pixel. Operations are done in the same order
+// as in the SIMD version, so that results are the same regardless of which version is used.
+image_type::pixel_type apply_general_pixel(
+	const image_type::pixel_type& px, //
+	const std::array<std::array<float, 4>, 4>& columns,
+	const std::array<float, 4>& offset
+)
+{
+	std::array<float, num_channels> u{};
+
+	auto d = get_unpremultiply_divisor(px.a());
+	for (unsigned i = 0; i != alpha_channel; ++i) {
+		u[i] = float(px[i]) / d;
+	}
+	u[alpha_channel] = float(px.a()) / channel_max;
+
+	std::array<float, num_channels> v{};
+	for (unsigned i = 0; i != num_channels; ++i) {
+		using std::clamp;
+		auto c = columns[0][i] * u[0] + columns[1][i] * u[1] + columns[2][i] * u[2] + columns[3][i] * u[3] + offset[i];
+		v[i] = clamp(c, 0.0f, 1.0f);
+	}
+
+	image_type::pixel_type ret;
+	for (unsigned i = 0; i != alpha_channel; ++i) {
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret[i] = uint8_t(v[i] * v[alpha_channel] * channel_max + 0.5f);
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	ret.a() = uint8_t(v[alpha_channel] * channel_max + 0.5f);
+
+	return ret;
+}
+} // namespace
+
+#if CFG_CPU == CFG_CPU_X86_64
+
+namespace {
+// Constants for the SSE2 version. Channels of a pixel are in four float lanes,
+// alpha is in the highest lane.
+struct general_sse2 {
+	// std::array of __m128 is not used because it gives "ignored attributes" warning
+	__m128 column0;
+	__m128 column1;
+	__m128 column2;
+	__m128 column3;
+	__m128 offset;
+
+	// all bits set in color lanes
+	__m128 color_mask;
+
+	__m128 alpha_max;
+	__m128 alpha_one;
+
+	__m128 zero;
+	__m128 one;
+	__m128 scale;
+	__m128 half;
+
+	general_sse2(const std::array<std::array<float, 4>, 4>& columns, const std::array<float, 4>& offset) :
+		column0(_mm_loadu_ps(columns[0].data())),
+		column1(_mm_loadu_ps(columns[1].data())),
+		column2(_mm_loadu_ps(columns[2].data())),
+		column3(_mm_loadu_ps(columns[3].data())),
+		offset(_mm_loadu_ps(offset.data())),
+		color_mask(_mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))),
+		alpha_max(_mm_set_ps(channel_max, 0, 0, 0)),
+		alpha_one(_mm_set_ps(1, 0, 0, 0)),
+		zero(_mm_setzero_ps()),
+		one(_mm_set1_ps(1)),
+		scale(_mm_set1_ps(channel_max)),
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		half(_mm_set1_ps(0.5f))
+	{}
+
+	// px is channel values of a pixel, returns resulting channel values as integers
+	__m128i apply(__m128 px) const
+	{
+		// unpremultiply, colors are divided by alpha and alpha is divided by 255
+		auto a = _mm_shuffle_ps(px, px, _MM_SHUFFLE(3, 3, 3, 3));
+		auto d = _mm_or_ps(_mm_and_ps(this->color_mask, _mm_max_ps(a, this->one)), this->alpha_max);
+		auto u = _mm_div_ps(px, d);
+
+		auto v = _mm_mul_ps(this->column0, _mm_shuffle_ps(u, u, _MM_SHUFFLE(0, 0, 0, 0)));
+		v = _mm_add_ps(v, _mm_mul_ps(this->column1, _mm_shuffle_ps(u, u, _MM_SHUFFLE(1, 1, 1, 1))));
+		v = _mm_add_ps(v, _mm_mul_ps(this->column2, _mm_shuffle_ps(u, u, _MM_SHUFFLE(2, 2, 2, 2))));
+		v = _mm_add_ps(v, _mm_mul_ps(this->column3, _mm_shuffle_ps(u, u, _MM_SHUFFLE(3, 3, 3, 3))));
+		v = _mm_add_ps(v, this->offset);
+
+		v = _mm_min_ps(_mm_max_ps(v, this->zero), this->one);
+
+		// premultiply, colors are multiplied by alpha and alpha is multiplied by 1
+		auto va = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+		v = _mm_mul_ps(v, _mm_or_ps(_mm_and_ps(this->color_mask, va), this->alpha_one));
+
+		// values are non-negative, so adding 0.5 and truncating rounds to nearest
+		return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, this->scale), this->half));
+	}
+};
+} // namespace
+
+namespace {
+// four pixels are processed at once
+void apply_general_sse2(
+	utki::span<image_type::pixel_type> dst, //
+	utki::span<const image_type::pixel_type> src,
+	const std::array<std::array<float, 4>, 4>& columns,
+	const std::array<float, 4>& offset
+)
+{
+	constexpr size_t pixels_per_step = sizeof(__m128i) / sizeof(image_type::pixel_type);
+
+	const general_sse2 k(columns, offset);
+
+	auto zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + pixels_per_step <= src.size(); i += pixels_per_step) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+
+		auto lo = _mm_unpacklo_epi8(v, zero);
+		auto hi = _mm_unpackhi_epi8(v, zero);
+
+		auto p0 = k.apply(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+		auto p1 = k.apply(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+		auto p2 = k.apply(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+		auto p3 = k.apply(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+
+		v = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]), v);
+	}
+
+	for (; i != src.size(); ++i) {
+		dst[i] = apply_general_pixel(src[i], columns, offset);
+	}
+}
+} // namespace
+
+#endif // ~CFG_CPU_X86_64
+
+void color_matrix_kernel::apply_general(
+	utki::span<image_type::pixel_type> dst, //
+	utki::span<const image_type::pixel_type> src
+) const
+{
+#if CFG_CPU == CFG_CPU_X86_64
+	// SSE2 is always supported by x86_64 CPUs
+	apply_general_sse2(dst, src, this->columns, this->offset);
+#else
+	auto dp = dst.begin();
+	for (const auto& px : src) {
+		*dp = apply_general_pixel(px, this->columns, this->offset);
+		++dp;
+	}
+#endif
+}
@@ -0,0 +1,101 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <array>
+
+#include <r4/matrix.hpp>
+#include <utki/span.hpp>
+
+#include "channel_luts.hxx"
+#include "config.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Per-pixel kernel of feColorMatrix.
+ * Applies 5x4 color matrix to unpremultiplied colors of premultiplied pixels.
+ * The resulting color values are clamped to [0, 1] and premultiplied back.
+ * The kernel analyzes the matrix upon construction and selects the fastest way to apply it:
+ * - identity matrix: pixels are copied as is;
+ * - alpha-only matrix, i.e. resulting color is always black, like in case of luminanceToAlpha:
+ *   only the alpha channel is calculated;
+ * - diagonal matrix, i.e. each resulting channel depends only on the same source channel:
+ *   per-channel lookup tables are used;
+ * - any other matrix, like saturate or hueRotate: full matrix multiplication using SIMD instructions
+ *   where available, several pixels at a time.
+ */
+class color_matrix_kernel
+{
+public:
+	enum class kind {
+		identity,
+		alpha_only,
+		diagonal,
+		general
+	};
+
+private:
+	kind matrix_kind;
+
+	// matrix columns, i.e. the coefficients of each source channel
+	std::array<std::array<float, 4>, 4> columns{};
+
+	// fifth column of the matrix
+	std::array<float, 4> offset{};
+
+	// for diagonal matrix, resulting value of each channel for each source value
+	channel_luts luts;
+
+	void apply_alpha_only(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src) const;
+	void apply_general(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src) const;
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param m - 1st to 4th columns of the 5x4 color matrix.
+	 * @param mc5 - 5th column of the 5x4 color matrix.
+	 */
+	color_matrix_kernel(const r4::matrix4<real>& m, const r4::vector4<real>& mc5);
+
+	kind get_kind() const noexcept
+	{
+		return this->matrix_kind;
+	}
+
+	/**
+	 * @brief Apply the color matrix to a row of pixels.
+	 * @param dst - destination pixels.
+	 * @param src - source pixels, must be of same size as destination.
+	 *              Can be the same pixels as the destination, then the kernel is applied in place.
+	 */
+	void apply(utki::span<image_type::pixel_type> dst, utki::span<const image_type::pixel_type> src) const;
+};
+
+} // namespace svgren
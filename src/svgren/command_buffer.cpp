@@ -0,0 +1,277 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "command_buffer.hxx"
+
+#include <utki/debug.hpp>
+
+#include "renderer.hxx"
+
+using namespace svgren;
+
+std::shared_ptr<veg::gradient> gradient_paint::make_gradient() const
+{
+	std::shared_ptr<veg::gradient> ret;
+	if (this->is_radial) {
+		ret = std::make_shared<veg::radial_gradient>(this->p1, this->p2, this->radius);
+	} else {
+		ret = std::make_shared<veg::linear_gradient>(this->p1, this->p2);
+	}
+
+	ret->set_stops(utki::make_span(this->stops));
+	ret->set_spread_method(this->spread_method);
+
+	return ret;
+}
+
+void command_buffer::replay(renderer& r) const
+{
+	auto& canvas = r.canvas;
+	ASSERT(!canvas.is_recording())
+
+	const auto base_matrix = canvas.get_matrix();
+
+	auto value_iter = this->values.begin();
+	auto gradient_iter = this->gradients.begin();
+	auto filter_iter = this->filters.begin();
+
+	auto next = [&value_iter]() {
+		return *value_iter++;
+	};
+
+	auto next_vector = [&value_iter]() {
+		r4::vector2<real> ret{value_iter[0], value_iter[1]};
+		value_iter += 2;
+		return ret;
+	};
+
+	std::vector<surface> background_stack;
+
+	std::vector<real> dashes;
+
+	for (auto op : this->opcodes) {
+		switch (op) {
+			case opcode::set_matrix:
+				{
+					render_canvas::matrix_type m;
+					for (auto& row : m) {
+						for (auto& e : row) {
+							e = next();
+						}
+					}
+					canvas.set_matrix(base_matrix);
+					canvas.transform(m);
+				}
+				break;
+			case opcode::move_abs:
+				canvas.move_abs(next_vector());
+				break;
+			case opcode::move_rel:
+				canvas.move_rel(next_vector());
+				break;
+			case opcode::line_abs:
+				canvas.line_abs(next_vector());
+				break;
+			case opcode::line_rel:
+				canvas.line_rel(next_vector());
+				break;
+			case opcode::quadratic_curve_abs:
+				{
+					auto cp = next_vector();
+					auto ep = next_vector();
+					canvas.quadratic_curve_abs(cp, ep);
+				}
+				break;
+			case opcode::quadratic_curve_rel:
+				{
+					auto cp = next_vector();
+					auto ep = next_vector();
+					canvas.quadratic_curve_rel(cp, ep);
+				}
+				break;
+			case opcode::cubic_curve_abs:
+				{
+					auto cp1 = next_vector();
+					auto cp2 = next_vector();
+					auto ep = next_vector();
+					canvas.cubic_curve_abs(cp1, cp2, ep);
+				}
+				break;
+			case opcode::cubic_curve_rel:
+				{
+					auto cp1 = next_vector();
+					auto cp2 = next_vector();
+					auto ep = next_vector();
+					canvas.cubic_curve_rel(cp1, cp2, ep);
+				}
+				break;
+			case opcode::arc_abs:
+				{
+					auto ep = next_vector();
+					auto radius = next_vector();
+					auto x_axis_rotation = next();
+					bool large_arc = next() != 0;
+					bool sweep = next() != 0;
+					canvas.arc_abs(ep, radius, x_axis_rotation, large_arc, sweep);
+				}
+				break;
+			case opcode::arc_rel:
+				{
+					auto ep = next_vector();
+					auto radius = next_vector();
+					auto x_axis_rotation = next();
+					bool large_arc = next() != 0;
+					bool sweep = next() != 0;
+					canvas.arc_rel(ep, radius, x_axis_rotation, large_arc, sweep);
+				}
+				break;
+			case opcode::arc_abs_angles:
+				{
+					auto center = next_vector();
+					auto radius = next_vector();
+					auto start_angle = next();
+					auto sweep_angle = next();
+					canvas.arc_abs(center, radius, start_angle, sweep_angle);
+				}
+				break;
+			case opcode::close_path:
+				canvas.close_path();
+				break;
+			case opcode::circle:
+				{
+					auto center = next_vector();
+					auto radius = next();
+					canvas.circle(center, radius);
+				}
+				break;
+			case opcode::rectangle:
+				{
+					auto p = next_vector();
+					auto d = next_vector();
+					canvas.rectangle({p, d});
+				}
+				break;
+			case opcode::rounded_rectangle:
+				{
+					auto p = next_vector();
+					auto d = next_vector();
+					auto corner_radius = next_vector();
+					canvas.rectangle({p, d}, corner_radius);
+				}
+				break;
+			case opcode::clear_path:
+				canvas.clear_path();
+				break;
+			case opcode::fill:
+				r.cancellation.check();
+				canvas.fill();
+				break;
+			case opcode::stroke:
+				r.cancellation.check();
+				canvas.stroke();
+				break;
+			case opcode::set_source_color:
+				{
+					r4::vector4<real> color;
+					for (auto& c : color) {
+						c = next();
+					}
+					canvas.set_source(color);
+				}
+				break;
+			case opcode::set_source_gradient:
+				ASSERT(gradient_iter != this->gradients.end())
+				canvas.set_source(*gradient_iter);
+				++gradient_iter;
+				break;
+			case opcode::set_fill_rule:
+				canvas.set_fill_rule(veg::fill_rule(unsigned(next())));
+				break;
+			case opcode::set_line_width:
+				canvas.set_line_width(next());
+				break;
+			case opcode::set_line_cap:
+				canvas.set_line_cap(veg::line_cap(unsigned(next())));
+				break;
+			case opcode::set_line_join:
+				canvas.set_line_join(veg::line_join(unsigned(next())));
+				break;
+			case opcode::set_dash_pattern:
+				{
+					dashes.resize(size_t(next()));
+					for (auto& d : dashes) {
+						d = next();
+					}
+					auto offset = next();
+					canvas.set_dash_pattern(utki::make_span(dashes), offset);
+				}
+				break;
+			case opcode::push_group:
+				canvas.push_group();
+				break;
+			case opcode::pop_group:
+				canvas.pop_group(next());
+				break;
+			case opcode::pop_mask_and_group:
+				canvas.pop_mask_and_group();
+				break;
+			case opcode::push_background:
+				background_stack.push_back(r.background);
+				r.background = surface(canvas.get_image_span());
+				break;
+			case opcode::pop_background:
+				ASSERT(!background_stack.empty())
+				r.background = background_stack.back();
+				background_stack.pop_back();
+				break;
+			case opcode::apply_filter:
+				{
+					ASSERT(filter_iter != this->filters.end())
+					const auto& f = *filter_iter;
+					++filter_iter;
+
+					// device space bounding box was recorded relative to the base matrix
+					auto matrix = canvas.get_matrix();
+					canvas.set_matrix(base_matrix);
+					auto p1 = canvas.matrix_mul(f.device_space_bounding_box.p1);
+					auto p2 = canvas.matrix_mul(f.device_space_bounding_box.p2);
+					canvas.set_matrix(matrix);
+
+					r.user_space_bounding_box = f.user_space_bounding_box;
+					r.device_space_bounding_box = {p1, p2};
+					r.viewport = f.viewport;
+
+					r.apply_filter(f.id);
+				}
+				break;
+		}
+	}
+
+	ASSERT(value_iter == this->values.end())
+	ASSERT(gradient_iter == this->gradients.end())
+	ASSERT(filter_iter == this->filters.end())
+}
@@ -0,0 +1,138 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <r4/rectangle.hpp>
+#include <r4/segment2.hpp>
+#include <veg/canvas.hpp>
+
+#include "config.hxx"
+
+namespace svgren {
+
+class renderer;
+
+/**
+ * @brief Description of a gradient paint.
+ * Holds everything needed to create the veg::gradient object.
+ */
+struct gradient_paint {
+	bool is_radial = false;
+
+	// for linear gradient these are start and end points,
+	// for radial gradient these are focal point and center
+	r4::vector2<real> p1 = 0;
+	r4::vector2<real> p2 = 0;
+
+	// radial gradient radius
+	real radius = 0;
+
+	std::vector<veg::gradient::stop> stops;
+	veg::gradient_spread_method spread_method = veg::gradient_spread_method::pad;
+
+	std::shared_ptr<veg::gradient> make_gradient() const;
+};
+
+/**
+ * @brief Filter application recorded to the command buffer.
+ * Filters need pixels of the rendered image, so those are not applied
+ * while recording, but the renderer state needed to apply the filter is saved.
+ */
+struct filter_application {
+	std::string id;
+	r4::rectangle<real> user_space_bounding_box;
+	r4::segment2<real> device_space_bounding_box;
+	r4::vector2<real> viewport;
+};
+
+enum class opcode : uint8_t {
+	set_matrix, // 6 values
+	move_abs, // 2 values
+	move_rel, // 2 values
+	line_abs, // 2 values
+	line_rel, // 2 values
+	quadratic_curve_abs, // 4 values
+	quadratic_curve_rel, // 4 values
+	cubic_curve_abs, // 6 values
+	cubic_curve_rel, // 6 values
+	arc_abs, // 7 values: end point, radius, x axis rotation, large arc flag, sweep flag
+	arc_rel, // 7 values: end point, radius, x axis rotation, large arc flag, sweep flag
+	arc_abs_angles, // 6 values: center, radius, start angle, sweep angle
+	close_path,
+	circle, // 3 values
+	rectangle, // 4 values
+	rounded_rectangle, // 6 values
+	clear_path,
+	fill,
+	stroke,
+	set_source_color, // 4 values
+	set_source_gradient, // next gradient
+	set_fill_rule, // 1 value
+	set_line_width, // 1 value
+	set_line_cap, // 1 value
+	set_line_join, // 1 value
+	set_dash_pattern, // 1 + n + 1 values: number of dashes, dashes, dash offset
+	push_group,
+	pop_group, // 1 value
+	pop_mask_and_group,
+	push_background,
+	pop_background,
+	apply_filter // next filter
+};
+
+/**
+ * @brief Flat buffer of drawing commands recorded from the renderer.
+ * Commands go in sequence, each command consumes its values from the values array,
+ * its gradient from the gradients array or its filter from the filters array in order,
+ * so there is no need to store any offsets.
+ * All style properties, paints and path steps are already resolved by the renderer,
+ * the matrix is recorded as absolute matrix only when it has changed.
+ */
+class command_buffer
+{
+public:
+	std::vector<opcode> opcodes;
+	std::vector<real> values;
+	std::vector<gradient_paint> gradients;
+	std::vector<filter_application> filters;
+
+	/**
+	 * @brief Replay the commands.
+	 * The commands are replayed onto the canvas of the renderer.
+	 * The current matrix of the canvas is used as a base matrix for all recorded matrices.
+	 * @param r - renderer to use for replaying. Must not be in recording mode.
+	 */
+	void replay(renderer& r) const;
+};
+
+} // namespace svgren
@@ -0,0 +1,85 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "display_list.hpp"
+
+#include "command_buffer.hxx"
+#include "limit_exceeded.hxx"
+#include "renderer.hxx"
+
+using namespace svgren;
+
+namespace {
+parameters make_dpi_parameters(unsigned dpi)
+{
+	parameters ret;
+	ret.dpi = dpi;
+	return ret;
+}
+} // namespace
+
+display_list::display_list(const prepared_document& doc, unsigned dpi) :
+	display_list(doc, make_dpi_parameters(dpi))
+{}
+
+display_list::display_list(const prepared_document& doc, const parameters& params) :
+	doc(doc),
+	dpi(params.dpi),
+	commands([&]() {
+		auto ret = std::make_shared<command_buffer>();
+
+		auto svg_dims = doc.svg.get_dimensions(svgdom::real(params.dpi));
+		if (!svg_dims.is_positive()) {
+			return ret;
+		}
+
+		// Nothing is drawn on the canvas during recording, it is only needed to track
+		// current path and matrix, so create it of minimal size.
+		veg::canvas canvas(r4::vector2<unsigned>(1));
+
+		// statistics are collected when the display list is rasterized
+		auto p = params;
+		p.stats = nullptr;
+
+		renderer r(canvas, svg_dims, doc, p);
+
+		r.canvas.start_recording(*ret);
+
+		try {
+			doc.svg.accept(r);
+			// NOLINTNEXTLINE(bugprone-empty-catch)
+		} catch (limit_exceeded&) {
+			// recording the root element would exceed the limits, nothing is recorded
+		}
+
+		// mask rendering errors are ignored, so cancellation during mask recording
+		// could have gone unnoticed, check once more
+		r.cancellation.check();
+
+		return ret;
+	}())
+{}
@@ -0,0 +1,105 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <memory>
+
+#include "prepared_document.hpp"
+#include "render.hpp"
+
+namespace svgren {
+
+class command_buffer;
+
+/**
+ * @brief Compiled SVG document.
+ * Display list is a flat sequence of drawing commands compiled from the SVG document.
+ * All styles, paints, transformations and path steps are resolved at compile time,
+ * so rasterizing the display list does not walk the SVG DOM.
+ * This is useful when the same SVG image is rasterized many times, e.g. an icon
+ * which is redrawn every frame.
+ *
+ * The display list is compiled in the SVG user space, so it can be rasterized
+ * to any raster image dimensions. The DPI though is fixed at compile time.
+ *
+ * The prepared document must outlive the display list.
+ */
+class display_list
+{
+	friend image_type rasterize(const display_list& dl, const parameters& params);
+
+	const prepared_document& doc;
+
+	unsigned dpi;
+
+	std::shared_ptr<const command_buffer> commands;
+
+public:
+	/**
+	 * @brief Compile SVG document.
+	 * @param doc - prepared SVG document to compile.
+	 * @param dpi - dots per inch to use for unit conversion to pixels.
+	 */
+	display_list(const prepared_document& doc, unsigned dpi = parameters::default_dpi);
+
+	/**
+	 * @brief Compile SVG document.
+	 * The params.dpi is used for unit conversion to pixels. The params.limits are checked while compiling,
+	 * elements which exceed the element visits, use depth or group depth limits are left out of the display list.
+	 * The rest of the parameters are ignored.
+	 * @param doc - prepared SVG document to compile.
+	 * @param params - rasterization parameters.
+	 * @throw svgren::canceled - in case the compilation was canceled via parameters::cancel_flag.
+	 * @throw svgren::deadline_exceeded - in case the parameters::deadline has passed.
+	 */
+	display_list(const prepared_document& doc, const parameters& params);
+
+	/**
+	 * @brief Get DPI the display list was compiled with.
+	 * @return DPI the display list was compiled with.
+	 */
+	unsigned get_dpi() const noexcept
+	{
+		return this->dpi;
+	}
+};
+
+/**
+ * @brief Create raster image from display list.
+ * The element visits, use depth and group depth limits are the ones the display list was compiled with,
+ * the filter effect limits of params.limits are checked while rasterizing.
+ * @param dl - display list to rasterize.
+ * @param params - rasterization parameters. The params.dpi is ignored, the DPI
+ *                 the display list was compiled with is used instead.
+ * @return Raster image of the display list.
+ * @throw svgren::canceled - in case the rasterization was canceled via parameters::cancel_flag.
+ * @throw svgren::deadline_exceeded - in case the parameters::deadline has passed.
+ */
+image_type rasterize(const display_list& dl, const parameters& params = parameters());
+
+} // namespace svgren
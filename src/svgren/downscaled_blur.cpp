@@ -0,0 +1,231 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "downscaled_blur.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <utki/debug.hpp>
+
+#include "parallel.hxx"
+
+using namespace svgren;
+
+namespace {
+// Standard deviation at reduced resolution is kept at least this big, so that
+// box sizes of the blur at reduced resolution are still large enough to approximate
+// the requested standard deviation well.
+constexpr real min_downscaled_std_deviation = 8;
+} // namespace
+
+r4::vector2<unsigned> svgren::get_blur_downscale_factor(r4::vector2<real> std_deviation)
+{
+	r4::vector2<unsigned> ret;
+	for (size_t i = 0; i != ret.size(); ++i) {
+		ret[i] = 1;
+		while (std_deviation[i] / real(ret[i] * 2) >= min_downscaled_std_deviation) {
+			ret[i] *= 2;
+		}
+	}
+	return ret;
+}
+
+namespace {
+// average blocks of factor.x() by factor.y() pixels, the blocks at right and bottom edges can be smaller
+image_type downscale(
+	image_span_type::const_image_span_type src, //
+	r4::vector2<unsigned> factor,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	using std::min;
+
+	const auto& src_dims = src.dims();
+
+	image_type ret(get_downscaled_dims(src_dims, factor));
+
+	// each row of the result is made from factor.y() source rows
+	parallel_for_ranges(num_threads, ret.dims().y(), size_t(src_dims.x()) * factor.y(), [&](size_t begin, size_t end) {
+		std::vector<r4::vector4<unsigned>> sums(ret.dims().x());
+
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
+
+			std::fill(sums.begin(), sums.end(), r4::vector4<unsigned>(0));
+
+			unsigned y_begin = y * factor.y();
+			unsigned y_end = min(y_begin + factor.y(), src_dims.y());
+
+			for (unsigned sy = y_begin; sy != y_end; ++sy) {
+				const auto& src_row = src[sy];
+				for (unsigned x = 0; x != src_dims.x(); ++x) {
+					sums[x / factor.x()] += src_row[x].to<unsigned>();
+				}
+			}
+
+			auto dst_row = ret.span()[y];
+			for (unsigned x = 0; x != ret.dims().x(); ++x) {
+				unsigned x_begin = x * factor.x();
+				unsigned x_end = min(x_begin + factor.x(), src_dims.x());
+
+				unsigned count = (x_end - x_begin) * (y_end - y_begin);
+
+				// rounded division
+				dst_row[x] = ((sums[x] + r4::vector4<unsigned>(count / 2)) / count).to<image_type::pixel_type::value_type>();
+			}
+		}
+	});
+
+	return ret;
+}
+} // namespace
+
+namespace {
+// position to sample from the source image for bilinear interpolation along one axis
+struct sample {
+	unsigned i0;
+	unsigned i1;
+
+	// weight of the sample at i1, in units of 1/256, weight of the sample at i0 is 256 - w1
+	unsigned w1;
+};
+
+constexpr unsigned weight_one = 256;
+
+std::vector<sample> make_samples(
+	unsigned dst_size, //
+	unsigned src_size,
+	unsigned factor
+)
+{
+	std::vector<sample> ret;
+	ret.reserve(dst_size);
+
+	for (unsigned i = 0; i != dst_size; ++i) {
+		using std::clamp;
+		using std::floor;
+		using std::min;
+
+		// pixel centers of the destination and source images are aligned
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		real pos = (real(i) + real(0.5)) / real(factor) - real(0.5);
+		pos = clamp(pos, real(0), real(src_size - 1));
+
+		auto i0 = unsigned(floor(pos));
+
+		ret.push_back({
+			i0, //
+			min(i0 + 1, src_size - 1),
+			unsigned(std::lround((pos - real(i0)) * real(weight_one)))
+		});
+	}
+
+	return ret;
+}
+} // namespace
+
+namespace {
+void upscale_bilinear(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<unsigned> factor,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	auto x_samples = make_samples(dst.dims().x(), src.dims().x(), factor.x());
+	auto y_samples = make_samples(dst.dims().y(), src.dims().y(), factor.y());
+
+	parallel_for_ranges(num_threads, dst.dims().y(), dst.dims().x(), [&](size_t begin, size_t end) {
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
+
+			const auto& ys = y_samples[y];
+
+			const auto& row0 = src[ys.i0];
+			const auto& row1 = src[ys.i1];
+
+			auto dst_row = dst[y];
+
+			for (unsigned x = 0; x != dst.dims().x(); ++x) {
+				const auto& xs = x_samples[x];
+
+				auto top = row0[xs.i0].to<unsigned>() * (weight_one - xs.w1) + row0[xs.i1].to<unsigned>() * xs.w1;
+				auto bottom = row1[xs.i0].to<unsigned>() * (weight_one - xs.w1) + row1[xs.i1].to<unsigned>() * xs.w1;
+
+				auto v = top * (weight_one - ys.w1) + bottom * ys.w1;
+
+				// rounded division by weight_one squared
+				constexpr auto weight_one_squared = weight_one * weight_one;
+				dst_row[x] = ((v + r4::vector4<unsigned>(weight_one_squared / 2)) / weight_one_squared)
+								 .to<image_type::pixel_type::value_type>();
+			}
+		}
+	});
+}
+} // namespace
+
+void svgren::downscaled_blur(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	r4::vector2<unsigned> factor,
+	blur_function_type blur,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	ASSERT(dst.dims() == src.dims())
+	ASSERT(blur)
+
+	if (src.dims().is_any_zero()) {
+		return;
+	}
+
+	auto small = downscale(src, factor, num_threads, cancellation);
+
+	// Averaging blocks of f pixels adds variance of about f^2 / 12 and bilinear upscaling by f
+	// adds variance of about f^2 / 6, this is subtracted from the requested variance.
+	r4::vector2<real> small_std_deviation;
+	for (size_t i = 0; i != small_std_deviation.size(); ++i) {
+		using std::max;
+		using std::sqrt;
+
+		auto f = real(factor[i]);
+		auto variance = std_deviation[i] * std_deviation[i] - f * f / 4;
+
+		small_std_deviation[i] = sqrt(max(variance, real(0))) / f;
+	}
+
+	image_type blurred(small.dims());
+	blur(blurred.span(), small.span(), small_std_deviation, num_threads, cancellation);
+
+	upscale_bilinear(dst, blurred.span(), factor, num_threads, cancellation);
+}
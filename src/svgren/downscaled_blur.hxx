@@ -0,0 +1,97 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include "cancellation_token.hxx"
+#include "config.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Blur function.
+ * Blurs source image with given standard deviations and writes result to destination image
+ * of the same dimensions.
+ */
+using blur_function_type = void (*)(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+);
+
+/**
+ * @brief Get downscale factor for blurring at reduced resolution.
+ * Large blurs leave no high-frequency content in the image, so these can be done at reduced resolution.
+ * The factor is the largest power of two which keeps the standard deviation at reduced resolution
+ * at least 8 pixels.
+ * @param std_deviation - standard deviation of the blur in pixels, for each axis.
+ * @return Downscale factor for each axis. Factor of 1 means no downscaling.
+ */
+r4::vector2<unsigned> get_blur_downscale_factor(r4::vector2<real> std_deviation);
+
+/**
+ * @brief Blur image at reduced resolution.
+ * The source image is downscaled by averaging blocks of pixels, blurred with the standard deviation
+ * reduced accordingly and upscaled back with bilinear interpolation.
+ * Downscaling and upscaling blur the image a bit themselves, this is compensated by the reduced
+ * standard deviation, so that the overall blur has the requested variance.
+ * With the factor given by get_blur_downscale_factor() and box blur each channel value of the result
+ * differs from the result of blurring at full resolution by at most 8. Near the image edges the difference
+ * can be bigger, because pixels outside of the image are taken from the edge pixels and edge pixels
+ * of the downscaled image are averages of several edge rows or columns.
+ * @param dst - destination image.
+ * @param src - source image, must be of same dimensions as destination image.
+ * @param std_deviation - standard deviation of the blur in pixels, for each axis.
+ * @param factor - downscale factor for each axis, must be a power of two.
+ * @param blur - blur function to use at reduced resolution.
+ * @param num_threads - maximum number of threads to use, 0 means number of CPU cores.
+ * @param cancellation - cancellation token.
+ */
+void downscaled_blur(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	r4::vector2<unsigned> factor,
+	blur_function_type blur,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+);
+
+/**
+ * @brief Get dimensions of downscaled image.
+ * @param dims - dimensions of the image.
+ * @param factor - downscale factor for each axis.
+ * @return Dimensions of the downscaled image.
+ */
+inline r4::vector2<unsigned> get_downscaled_dims(r4::vector2<unsigned> dims, r4::vector2<unsigned> factor)
+{
+	return (dims + factor - 1).comp_div(factor);
+}
+
+} // namespace svgren
@@ -27,120 +27,94 @@ SOFTWARE.
 
 #include "filter_applier.hxx"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <stdexcept>
 
 #include <r4/matrix.hpp>
-#include <rasterimage/operations.hpp>
 #include <utki/debug.hpp>
 #include <utki/math.hpp>
 
+#include "box_blur.hxx"
+#include "color_matrix.hxx"
+#include "downscaled_blur.hxx"
+#include "limit_exceeded.hxx"
+#include "parallel.hxx"
+#include "pixel_ops.hxx"
+#include "recursive_blur.hxx"
 #include "util.hxx"
 
 using namespace svgren;
 
 namespace {
-void box_blur_horizontal(
-	image_span_type dst, //
-	image_span_type::const_image_span_type src,
-	unsigned box_size,
-	unsigned box_offset
-)
+r4::vector2<unsigned> get_box_blur_size(r4::vector2<real> std_deviation)
 {
-	ASSERT(dst.dims() == src.dims())
-	const auto& dims = src.dims();
-
-	if (box_size == 0) {
-		return;
-	}
-
-	for (auto [src_line, dst_line] : utki::views::zip(src, dst)) {
-		using std::min;
-		using std::max;
-
-		r4::vector4<unsigned> sum = 0;
-
-		// calculate first value for sum
-		for (unsigned i = 0; i != box_size; ++i) {
-			int pos = int(i) - int(box_offset);
-			pos = max(pos, 0);
-			pos = min(pos, int(src_line.size()) - 1);
-
-			sum += src_line[pos].to<unsigned>();
-		}
-
-		for (unsigned x = 0; x != dims.x(); ++x) {
-			int tmp = int(x) - int(box_offset);
-			int last = max(tmp, 0);
-			int next = min(tmp + int(box_size), int(dims.x()) - 1);
-
-			dst_line[x] = (sum / box_size).to<image_type::pixel_type::value_type>();
+	// see https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement for Gaussian Blur approximation algorithm
 
-			sum += src_line[next].to<unsigned>();
-			sum -= src_line[last].to<unsigned>();
-		}
-	}
+	using std::sqrt;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	return (std_deviation * (3 * sqrt(2 * real(utki::pi)) / 4) + real(0.5)).to<unsigned>();
 }
 } // namespace
 
 namespace {
-void box_blur_vertical(
-	image_span_type dst, //
-	image_span_type::const_image_span_type src,
-	unsigned box_size,
-	unsigned box_offset
-)
+r4::vector2<unsigned> get_box_blur_reach(r4::vector2<real> std_deviation)
 {
-	ASSERT(dst.dims() == src.dims())
-	const auto& dims = src.dims();
-
-	if (box_size == 0) {
-		return;
-	}
-	for (unsigned x = 0; x != dims.x(); ++x) {
-		using std::min;
-		using std::max;
+	auto d = get_box_blur_size(std_deviation);
 
-		r4::vector4<unsigned> sum = 0;
+	// each of three box blur passes reads at most d / 2 + 1 pixels to each side
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	return (d / 2 + 1) * 3;
+}
+} // namespace
 
-		// calculate first value for sum
-		for (unsigned i = 0; i != box_size; ++i) {
-			int pos = int(i) - int(box_offset);
-			pos = max(pos, 0);
-			pos = min(pos, int(dims.y()) - 1);
+namespace {
+r4::vector2<unsigned> get_recursive_blur_reach(r4::vector2<real> std_deviation)
+{
+	// Recursive filter response is infinite, but beyond 3 standard deviations
+	// the Gaussian is less than 0.5% of its peak, which is below 8-bit color precision.
+	using std::ceil;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	return ceil(std_deviation * 3).to<unsigned>();
+}
+} // namespace
 
-			sum += src[pos][x].to<unsigned>();
-		}
+namespace {
+// Cost of the recursive blur per pixel relative to the cost of one box blur pass per pixel.
+// Measured with the kernels benchmark, see tests/bench.
+constexpr uint64_t recursive_blur_cost = 15;
 
-		for (unsigned y = 0; y != dims.y(); ++y) {
-			int tmp = int(y) - int(box_offset);
-			int last = max(tmp, 0);
-			int next = min(tmp + int(box_size), int(dims.y()) - 1);
+bool is_recursive_blur_faster(
+	r4::vector2<unsigned> dims, //
+	r4::vector2<unsigned> box_size
+)
+{
+	auto w = uint64_t(dims.x());
+	auto h = uint64_t(dims.y());
 
-			dst[y][x] = (sum / box_size).to<image_type::pixel_type::value_type>();
+	// each of three box blur passes along an axis processes all pixels of a line plus
+	// box size pixels for the initial sum of the line
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	auto box_cost = 3 * h * (w + box_size.x()) + 3 * w * (h + box_size.y());
 
-			sum += src[next][x].to<unsigned>();
-			sum -= src[last][x].to<unsigned>();
-		}
-	}
+	return recursive_blur_cost * w * h < box_cost;
 }
 } // namespace
 
 namespace {
-filter_result blur_surface(
-	const surface& src, //
-	r4::vector2<real> std_deviation
+// Gaussian blur approximated by three box blurs
+void box_gaussian_blur(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	unsigned num_threads,
+	const cancellation_token& cancellation
 )
 {
-	// see https://www.w3.org/TR/SVG11/filters.html#feGaussianBlurElement for Gaussian Blur approximation algorithm
-
-	using std::sqrt;
-	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
-	auto d = (std_deviation * (3 * sqrt(2 * real(utki::pi)) / 4) + real(0.5)).to<unsigned>();
-
-	filter_result ret(src.rect());
+	auto d = get_box_blur_size(std_deviation);
 
-	image_type tmp(ret.image.dims());
+	image_type tmp(dst.dims());
 
 	std::array<unsigned, 3> h_box_size{};
 	std::array<unsigned, 3> h_offset{};
@@ -186,48 +160,233 @@ filter_result blur_surface(
 		v_box_size[2] = d.y();
 	}
 
-	box_blur_horizontal(
-		tmp.span(), //
-		src.image_span,
-		h_box_size[0],
-		h_offset[0]
-	);
-	box_blur_horizontal(
-		ret.surface.image_span, //
-		tmp.span(),
-		h_box_size[1],
-		h_offset[1]
-	);
-	box_blur_horizontal(
-		tmp.span(), //
-		ret.surface.image_span,
-		h_box_size[2],
-		h_offset[2]
-	);
+	const auto& dims = dst.dims();
+
+	// Rows are blurred horizontally independently of each other, so all three horizontal passes
+	// are done by each thread for its own range of rows.
+	parallel_for_ranges(num_threads, dims.y(), dims.x(), [&](size_t begin, size_t end) {
+		r4::rectangle<unsigned> rows({0, unsigned(begin)}, {dims.x(), unsigned(end - begin)});
+
+		auto src_rows = src.subspan(rows);
+		auto dst_rows = dst.subspan(rows);
+		auto tmp_rows = tmp.span().subspan(rows);
+
+		box_blur_horizontal(
+			tmp_rows, //
+			src_rows,
+			h_box_size[0],
+			h_offset[0],
+			cancellation
+		);
+		box_blur_horizontal(
+			dst_rows, //
+			tmp_rows,
+			h_box_size[1],
+			h_offset[1],
+			cancellation
+		);
+		box_blur_horizontal(
+			tmp_rows, //
+			dst_rows,
+			h_box_size[2],
+			h_offset[2],
+			cancellation
+		);
+	});
+
+	// same for vertical passes, each thread blurs its own range of columns
+	parallel_for_ranges(num_threads, dims.x(), dims.y(), [&](size_t begin, size_t end) {
+		r4::rectangle<unsigned> columns({unsigned(begin), 0}, {unsigned(end - begin), dims.y()});
+
+		auto dst_columns = dst.subspan(columns);
+		auto tmp_columns = tmp.span().subspan(columns);
+
+		box_blur_vertical(
+			dst_columns, //
+			tmp_columns,
+			v_box_size[0],
+			v_offset[0],
+			cancellation
+		);
+		box_blur_vertical(
+			tmp_columns, //
+			dst_columns,
+			v_box_size[1],
+			v_offset[1],
+			cancellation
+		);
+		box_blur_vertical(
+			dst_columns, //
+			tmp_columns,
+			v_box_size[2],
+			v_offset[2],
+			cancellation
+		);
+	});
+}
+} // namespace
 
-	box_blur_vertical(
-		ret.surface.image_span, //
-		tmp.span(),
-		v_box_size[0],
-		v_offset[0]
-	);
-	box_blur_vertical(
-		tmp.span(), //
-		ret.surface.image_span,
-		v_box_size[1],
-		v_offset[1]
-	);
-	box_blur_vertical(
-		ret.surface.image_span, //
-		tmp.span(),
-		v_box_size[2],
-		v_offset[2]
-	);
+namespace {
+void blur_surface(
+	filter_result& ret, //
+	const surface& src,
+	r4::vector2<real> std_deviation,
+	r4::vector2<unsigned> downscale_factor,
+	blur_function_type blur,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	ASSERT(ret.surface.rect().d == src.rect().d)
+
+	if (downscale_factor == r4::vector2<unsigned>(1)) {
+		blur(
+			ret.surface.image_span, //
+			src.image_span,
+			std_deviation,
+			num_threads,
+			cancellation
+		);
+	} else {
+		downscaled_blur(
+			ret.surface.image_span, //
+			src.image_span,
+			std_deviation,
+			downscale_factor,
+			blur,
+			num_threads,
+			cancellation
+		);
+	}
+}
+} // namespace
 
-	return ret;
+namespace {
+size_t get_image_memory(r4::vector2<unsigned> dims)
+{
+	return size_t(dims.x()) * size_t(dims.y()) * sizeof(image_type::pixel_type);
 }
 } // namespace
 
+void filter_applier::add_memory(size_t size)
+{
+	this->memory_used += size;
+
+	if (this->memory_used > this->r.limits.max_filter_memory) {
+		throw limit_exceeded("filter memory limit exceeded");
+	}
+
+	if (this->r.stats) {
+		using std::max;
+		auto& stats = this->r.stats->stats;
+		stats.peak_filter_memory = max(stats.peak_filter_memory, this->memory_used);
+	}
+}
+
+void filter_applier::reserve_memory(r4::vector2<unsigned> dims, unsigned num_images)
+{
+	auto size = get_image_memory(dims) * num_images;
+	this->add_memory(size);
+	this->temporary_memory += size;
+}
+
+filter_result filter_applier::make_result(r4::rectangle<unsigned> rect)
+{
+	auto i = std::find_if(this->free_images.begin(), this->free_images.end(), [&](const auto& img) {
+		return img.dims() == rect.d;
+	});
+	if (i != this->free_images.end()) {
+		auto img = std::move(*i);
+		this->free_images.erase(i);
+		return {rect.p, std::move(img)};
+	}
+
+	// none of the released images fits, free those before allocating a new one
+	for (const auto& img : this->free_images) {
+		this->memory_used -= get_image_memory(img.dims());
+	}
+	this->free_images.clear();
+
+	this->add_memory(get_image_memory(rect.d));
+
+	return {rect};
+}
+
+filter_result filter_applier::make_pointwise_result(
+	r4::rectangle<unsigned> rect, //
+	const pointwise_input& in,
+	const pointwise_input& in2
+)
+{
+	for (const auto& owner : {in.owner, in2.owner}) {
+		// the pixels are not to be overwritten if the other input reads them too
+		if (!owner || in.owner == in2.owner || this->is_needed(*owner) || this->is_viewed(*owner)) {
+			continue;
+		}
+
+		auto i = this->results.find(*owner);
+		ASSERT(i != this->results.end())
+
+		// Each result pixel depends only on the input pixels at the same position, which are read
+		// before the result pixel is written, so the input can be overwritten in place.
+		auto ret = std::move(i->second);
+		this->results.erase(i);
+
+		ret.surface = ret.surface.intersection(rect);
+		ASSERT(ret.surface.rect().d == rect.d)
+
+		return ret;
+	}
+
+	return this->make_result(rect);
+}
+
+bool filter_applier::is_needed(size_t index) const
+{
+	if (!this->r.filter_result_release) {
+		// all results are kept till the end of the filter effect
+		return true;
+	}
+
+	const auto& p = this->plan.get(index);
+	ASSERT(p)
+	return p->last_use > this->current_primitive || index == this->plan.get_last();
+}
+
+bool filter_applier::is_viewed(size_t index) const
+{
+	// views point directly to the owner of the pixels, so one level of indirection is to be checked
+	return std::any_of(this->results.begin(), this->results.end(), [&](const auto& r) {
+		return r.second.owner == index && this->is_needed(r.first);
+	});
+}
+
+void filter_applier::release_dead_results()
+{
+	// keep at most this many released images for reuse
+	constexpr size_t max_free_images = 2;
+
+	for (auto i = this->results.begin(); i != this->results.end();) {
+		if (this->is_needed(i->first) || this->is_viewed(i->first)) {
+			++i;
+			continue;
+		}
+
+		if (i->second.is_view()) {
+			i = this->results.erase(i);
+			continue;
+		}
+
+		this->free_images.push_back(std::move(i->second.image));
+		if (this->free_images.size() > max_free_images) {
+			this->memory_used -= get_image_memory(this->free_images.front().dims());
+			this->free_images.erase(this->free_images.begin());
+		}
+
+		i = this->results.erase(i);
+	}
+}
+
 surface filter_applier::get_source_graphic()
 {
 	auto img_span = this->r.canvas.get_image_span();
@@ -240,25 +399,23 @@ surface filter_applier::get_source_graphic()
 	};
 }
 
-void filter_applier::set_result(
-	const std::string& name, //
-	filter_result&& result
-)
+void filter_applier::set_result(filter_result&& result)
 {
-	auto res = this->results.insert(std::make_pair(name, std::move(result)));
-
-	if (!res.second) {
-		// result with given name is already there
-		// TODO: should not happen? ASSERT?
-		return;
+	if (this->r.stats) {
+		auto& stats = this->r.stats->stats;
+		++stats.num_filter_primitives;
+		stats.num_filter_pixels += size_t(result.surface.rect().d.x()) * size_t(result.surface.rect().d.y());
 	}
 
-	this->lastResult = &res.first->second;
+	auto res = this->results.insert_or_assign(this->current_primitive, std::move(result));
+
+	[[maybe_unused]] const auto& stored = res.first->second;
 	ASSERT(
-		this->lastResult->image.pixels().size() == 0 ||
-			this->lastResult->surface.image_span.data() == this->lastResult->image.pixels().data(),
+		stored.surface.image_span.empty() || stored.is_view() ||
+			(stored.surface.image_span.data() >= stored.image.pixels().data() &&
+			 stored.surface.image_span.data() < stored.image.pixels().data() + stored.image.pixels().size()),
 		[&](auto& o) {
-			o << "this->lastResult->image.pixels().size() = " << this->lastResult->image.pixels().size();
+			o << "stored.image.pixels().size() = " << stored.image.pixels().size();
 		}
 	)
 }
@@ -290,10 +447,15 @@ surface filter_applier::get_source(const std::string& in)
 		throw std::logic_error("StrokePaint not implemented");
 	}
 
-	auto i = this->results.find(in);
-	if (i != this->results.end()) {
-		// TRACE(<< "results" << std::endl)
-		return i->second.surface;
+	if (auto producer = this->names.resolve(in)) {
+		auto i = this->results.find(*producer);
+		if (i != this->results.end()) {
+			// TRACE(<< "results" << std::endl)
+			return i->second.surface;
+		}
+
+		// the producing filter primitive has not produced any result
+		return {};
 	}
 
 	if (in.length() == 0) {
@@ -306,12 +468,309 @@ surface filter_applier::get_source(const std::string& in)
 	return {};
 }
 
+std::optional<size_t> filter_applier::get_owner(const std::string& in)
+{
+	if (is_standard_filter_input(in)) {
+		return {};
+	}
+
+	auto producer = this->names.resolve(in);
+	if (!producer) {
+		return {};
+	}
+
+	auto i = this->results.find(*producer);
+	if (i == this->results.end()) {
+		return {};
+	}
+
+	if (i->second.is_view()) {
+		return i->second.owner;
+	}
+	return producer;
+}
+
+pointwise_input filter_applier::get_pointwise_source(const std::string& in)
+{
+	if (this->fused_result && !is_standard_filter_input(in) &&
+		this->names.resolve(in) == this->fused_result->first)
+	{
+		auto ret = std::move(this->fused_result->second);
+		this->fused_result.reset();
+		return ret;
+	}
+
+	return {this->get_source(in), {}, this->get_owner(in)};
+}
+
 surface filter_applier::get_last_result()
 {
-	if (!this->lastResult) {
+	auto last = this->names.get_last();
+	if (!last) {
+		return {};
+	}
+
+	auto i = this->results.find(*last);
+	if (i == this->results.end()) {
 		return {};
 	}
-	return this->lastResult->surface;
+	return i->second.surface;
+}
+
+r4::rectangle<real> filter_applier::get_region(
+	const svgdom::length& x, //
+	const svgdom::length& y,
+	const svgdom::length& width,
+	const svgdom::length& height,
+	svgdom::coordinate_units units
+)
+{
+	switch (units) {
+		default:
+		case svgdom::coordinate_units::object_bounding_box:
+			{
+				r4::vector2<real> fe_pos{percent_to_fraction(x), percent_to_fraction(y)};
+
+				r4::vector2<real> fe_dims{percent_to_fraction(width), percent_to_fraction(height)};
+
+				return {
+					this->r.device_space_bounding_box.p1 + fe_pos.comp_mul(this->r.device_space_bounding_box.dims()),
+					fe_dims.comp_mul(this->r.device_space_bounding_box.dims())
+				};
+			}
+		case svgdom::coordinate_units::user_space_on_use:
+			{
+				auto p1 = this->r.length_to_px(x, y);
+				auto p2 = p1 + this->r.length_to_px(width, height);
+
+				std::array<r4::vector2<real>, 4> rect_vertices = {
+					{p1, p2, {p1.x(), p2.y()}, {p2.x(), p1.y()}}
+				};
+
+				auto fr_bb = r4::segment2<real>().set_empty_bounding_box();
+
+				for (auto& vertex : rect_vertices) {
+					vertex = this->r.canvas.matrix_mul(vertex);
+
+					r4::segment2<real> bb{
+						{vertex.x(), vertex.y()},
+						{vertex.x(), vertex.y()}
+					};
+
+					fr_bb.unite(bb);
+				}
+
+				return {fr_bb.p1, fr_bb.dims()};
+			}
+	}
+}
+
+r4::rectangle<unsigned> filter_applier::get_subregion(
+	const svgdom::length& x, //
+	const svgdom::length& y,
+	const svgdom::length& width,
+	const svgdom::length& height
+)
+{
+	// unspecified subregion attributes of filter primitives are set to their default values by svgdom
+	auto is_specified = [](const svgdom::length& l, real default_percent) {
+		return l.is_valid() && !(l.is_percent() && real(l.value) == default_percent);
+	};
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	constexpr auto hundred_percent = real(100);
+
+	std::array<bool, 2> pos_specified = {is_specified(x, 0), is_specified(y, 0)};
+	std::array<bool, 2> dims_specified = {is_specified(width, hundred_percent), is_specified(height, hundred_percent)};
+
+	if (!pos_specified[0] && !pos_specified[1] && !dims_specified[0] && !dims_specified[1]) {
+		return this->filterRegion;
+	}
+
+	const auto zero = svgdom::length(0);
+
+	auto sr = this->get_region(
+		pos_specified[0] ? x : zero, //
+		pos_specified[1] ? y : zero,
+		dims_specified[0] ? width : zero,
+		dims_specified[1] ? height : zero,
+		this->primitiveUnits
+	);
+
+	// unspecified attributes are taken from the filter region
+	r4::rectangle<unsigned> ret;
+	for (size_t i = 0; i != ret.p.size(); ++i) {
+		using std::floor;
+		using std::ceil;
+		using std::max;
+
+		real begin = pos_specified[i] ? sr.p[i] : real(this->filterRegion.p[i]);
+		real end = begin + (dims_specified[i] ? sr.d[i] : real(this->filterRegion.d[i]));
+
+		begin = max(floor(begin), real(0));
+		end = max(ceil(end), begin);
+
+		ret.p[i] = unsigned(begin);
+		ret.d[i] = unsigned(end - begin);
+	}
+
+	return ret.intersect(this->filterRegion);
+}
+
+r4::vector2<real> filter_applier::get_blur_std_deviation(const svgdom::fe_gaussian_blur_element& e)
+{
+	auto sd = e.get_std_deviation().to<real>();
+
+	switch (this->primitiveUnits) {
+		default:
+		case svgdom::coordinate_units::user_space_on_use:
+			return this->r.canvas.matrix_mul_distance(sd);
+		case svgdom::coordinate_units::object_bounding_box:
+			return this->r.canvas.matrix_mul_distance(this->r.user_space_bounding_box.d.comp_mul(sd));
+	}
+}
+
+namespace {
+// reach of the blur, whichever algorithm and downscaling is used for it
+r4::vector2<unsigned> get_max_blur_reach(r4::vector2<real> std_deviation)
+{
+	using std::max;
+
+	auto box = get_box_blur_reach(std_deviation);
+	auto recursive = get_recursive_blur_reach(std_deviation);
+
+	return r4::vector2<unsigned>{max(box.x(), recursive.x()), max(box.y(), recursive.y())} +
+		get_blur_downscale_factor(std_deviation) * 2;
+}
+} // namespace
+
+class filter_applier::geometry_getter : public svgdom::const_visitor
+{
+	filter_applier& fa;
+
+public:
+	r4::rectangle<unsigned> subregion;
+
+	// how far around the result pixels the inputs are read
+	r4::vector2<unsigned> input_reach = 0;
+
+	geometry_getter(filter_applier& fa) :
+		fa(fa),
+		subregion(fa.filterRegion)
+	{}
+
+	void visit(const svgdom::fe_gaussian_blur_element& e) override
+	{
+		this->set_subregion(e);
+
+		if (e.is_std_deviation_specified()) {
+			this->input_reach = get_max_blur_reach(this->fa.get_blur_std_deviation(e));
+		}
+	}
+
+	void visit(const svgdom::fe_color_matrix_element& e) override
+	{
+		this->set_subregion(e);
+	}
+
+	void visit(const svgdom::fe_blend_element& e) override
+	{
+		this->set_subregion(e);
+	}
+
+	void visit(const svgdom::fe_composite_element& e) override
+	{
+		this->set_subregion(e);
+	}
+
+private:
+	template <typename element_type>
+	void set_subregion(const element_type& e)
+	{
+		this->subregion = this->fa.get_subregion(e.x, e.y, e.width, e.height);
+	}
+};
+
+namespace {
+bool is_empty(const r4::rectangle<unsigned>& r)
+{
+	return r.d.x() == 0 || r.d.y() == 0;
+}
+} // namespace
+
+namespace {
+// bounding box of two rectangles, empty rectangles are ignored
+r4::rectangle<unsigned> unite(const r4::rectangle<unsigned>& a, const r4::rectangle<unsigned>& b)
+{
+	if (is_empty(a)) {
+		return b;
+	}
+	if (is_empty(b)) {
+		return a;
+	}
+
+	using std::min;
+	using std::max;
+
+	auto p1 = r4::vector2<unsigned>{min(a.p.x(), b.p.x()), min(a.p.y(), b.p.y())};
+	auto a2 = a.p + a.d;
+	auto b2 = b.p + b.d;
+	auto p2 = r4::vector2<unsigned>{max(a2.x(), b2.x()), max(a2.y(), b2.y())};
+
+	return {p1, p2 - p1};
+}
+} // namespace
+
+namespace {
+// rectangle grown by the given distance to each side, not going below zero coordinates
+r4::rectangle<unsigned> expand(const r4::rectangle<unsigned>& r, r4::vector2<unsigned> distance)
+{
+	using std::min;
+
+	r4::vector2<unsigned> left_top_distance{min(r.p.x(), distance.x()), min(r.p.y(), distance.y())};
+
+	return {r.p - left_top_distance, r.d + left_top_distance + distance};
+}
+} // namespace
+
+void filter_applier::plan_regions(const svgdom::filter_element& e)
+{
+	this->regions.assign(e.children.size(), {0, 0});
+
+	auto last = this->plan.get_last();
+	if (!last) {
+		return;
+	}
+
+	// regions of the results which are needed by the following filter primitives
+	std::vector<r4::rectangle<unsigned>> needed(e.children.size(), {0, 0});
+	needed[*last] = this->filterRegion;
+
+	for (size_t i = e.children.size(); i != 0;) {
+		--i;
+
+		const auto& p = this->plan.get(i);
+		if (!p) {
+			continue;
+		}
+
+		geometry_getter geometry(*this);
+		e.children[i]->accept(geometry);
+
+		auto region = needed[i].intersect(geometry.subregion);
+		this->regions[i] = region;
+
+		if (is_empty(region)) {
+			// nobody needs the result
+			continue;
+		}
+
+		auto input_region = expand(region, geometry.input_reach).intersect(this->filterRegion);
+
+		for (auto producer : p->producers) {
+			needed[producer] = unite(needed[producer], input_region);
+		}
+	}
 }
 
 void filter_applier::visit(const svgdom::filter_element& e)
@@ -320,136 +779,177 @@ void filter_applier::visit(const svgdom::filter_element& e)
 
 	// set filter region
 	{
-		// filter region
-		auto fr = [this, &e]() -> r4::rectangle<real> {
-			switch (e.filter_units) {
-				default:
-				case svgdom::coordinate_units::object_bounding_box:
-					{
-						r4::vector2<real> fe_pos{percent_to_fraction(e.x), percent_to_fraction(e.y)};
-
-						r4::vector2<real> fe_dims{percent_to_fraction(e.width), percent_to_fraction(e.height)};
-
-						return {
-							this->r.device_space_bounding_box.p1 +
-								fe_pos.comp_mul(this->r.device_space_bounding_box.dims()),
-							fe_dims.comp_mul(this->r.device_space_bounding_box.dims())
-						};
-					}
-				case svgdom::coordinate_units::user_space_on_use:
-					{
-						auto p1 = this->r.length_to_px(e.x, e.y);
-						auto p2 = p1 + this->r.length_to_px(e.width, e.height);
+		auto fr = this->get_region(e.x, e.y, e.width, e.height, e.filter_units);
 
-						std::array<r4::vector2<real>, 4> rect_vertices = {
-							{p1, p2, {p1.x(), p2.y()}, {p2.x(), p1.y()}}
-						};
+		using std::floor;
+		using std::ceil;
+		using std::max;
 
-						auto fr_bb = r4::segment2<real>().set_empty_bounding_box();
+		// the part of the region before the canvas origin is cut off, the region end stays where it is
+		auto p1 = max(floor(fr.p), 0);
+		auto p2 = max(ceil(fr.p + fr.d), p1);
 
-						for (auto& vertex : rect_vertices) {
-							vertex = this->r.canvas.matrix_mul(vertex);
+		this->filterRegion.p = p1.to<unsigned>();
+		this->filterRegion.d = (p2 - p1).to<unsigned>();
+	}
 
-							r4::segment2<real> bb{
-								{vertex.x(), vertex.y()},
-								{vertex.x(), vertex.y()}
-							};
+	this->plan = filter_plan(e);
+	this->plan_regions(e);
 
-							fr_bb.unite(bb);
-						}
+	for (size_t i = 0; i != e.children.size(); ++i) {
+		this->current_primitive = i;
 
-						return {fr_bb.p1, fr_bb.dims()};
-					}
+		e.children[i]->accept(*this);
+
+		if (const auto& p = this->plan.get(i)) {
+			this->names.add(p->result, i);
+
+			// result of a fused primitive is consumed by the next primitive, it must not outlive it
+			if (!p->fused) {
+				ASSERT(!this->fused_result)
+				this->fused_result.reset();
 			}
-		}();
+		}
 
-		using std::floor;
-		using std::ceil;
-		using std::max;
+		this->release_dead_results();
+
+		// temporary images of the filter primitive are freed by now
+		this->memory_used -= this->temporary_memory;
+		this->temporary_memory = 0;
+	}
+}
+
+namespace {
+// Region of the blur source needed to blur the given region of the result.
+// The region is aligned to the downscaling blocks counted from the source position,
+// so that the blocks are the same as when blurring the whole source.
+r4::rectangle<unsigned> get_blur_input_region(
+	const r4::rectangle<unsigned>& region, //
+	r4::vector2<unsigned> source_position,
+	r4::vector2<unsigned> reach,
+	r4::vector2<unsigned> downscale_factor
+)
+{
+	if (is_empty(region)) {
+		return region;
+	}
+
+	auto ret = expand(region, reach);
 
-		this->filterRegion.p = max(floor(fr.p), 0).to<unsigned>();
-		this->filterRegion.d = max(ceil(fr.d), 0).to<unsigned>();
+	for (size_t i = 0; i != ret.p.size(); ++i) {
+		if (ret.p[i] <= source_position[i]) {
+			continue;
+		}
+		auto misalignment = (ret.p[i] - source_position[i]) % downscale_factor[i];
+		ret.p[i] -= misalignment;
+		ret.d[i] += misalignment;
 	}
 
-	this->relay_accept(e);
+	return ret;
 }
+} // namespace
 
 void filter_applier::visit(const svgdom::fe_gaussian_blur_element& e)
 {
 	if (!e.is_std_deviation_specified()) {
 		return;
 	}
-	auto sd = e.get_std_deviation().to<real>();
+	auto sd = this->get_blur_std_deviation(e);
 
-	switch (this->primitiveUnits) {
-		default:
-		case svgdom::coordinate_units::user_space_on_use:
-			sd = this->r.canvas.matrix_mul_distance(sd);
+	auto d = get_box_blur_size(sd);
+
+	if (d.x() > this->r.limits.max_blur_size || d.y() > this->r.limits.max_blur_size) {
+		throw limit_exceeded("blur size limit exceeded");
+	}
+
+	auto downscale_factor = this->r.blur_downscaling ? get_blur_downscale_factor(sd) : r4::vector2<unsigned>(1);
+
+	const auto& region = this->regions[this->current_primitive];
+
+	auto src = this->get_source(e.in).intersection(this->filterRegion);
+
+	// only the part of the source which affects the needed region of the result is blurred
+	auto s = src.intersection(get_blur_input_region(region, src.rect().p, get_max_blur_reach(sd), downscale_factor));
+
+	auto small_dims = get_downscaled_dims(s.rect().d, downscale_factor);
+
+	bool recursive = false;
+	switch (this->r.blur) {
+		case blur_algorithm::automatic:
+			recursive = is_recursive_blur_faster(small_dims, get_box_blur_size(sd.comp_div(downscale_factor.to<real>())));
 			break;
-		case svgdom::coordinate_units::object_bounding_box:
-			sd = this->r.canvas.matrix_mul_distance(this->r.user_space_bounding_box.d.comp_mul(sd));
+		case blur_algorithm::box:
+			break;
+		case blur_algorithm::recursive:
+			recursive = true;
 			break;
 	}
 
-	auto s = this->get_source(e.in).intersection(this->filterRegion);
+	auto result = this->make_result(s.rect());
+
+	if (downscale_factor != r4::vector2<unsigned>(1)) {
+		// downscaled source image and blurred downscaled image
+		this->reserve_memory(small_dims, 2);
+
+		// downscaling averages pixels within the block and upscaling interpolates between the blocks
+		this->reach += downscale_factor * 2;
+	}
+
+	if (recursive) {
+		// temporary float image which is sizeof(float) times larger
+		this->reserve_memory(small_dims, unsigned(sizeof(float)));
 
-	// TODO: set filter sub-region
+		this->reach += get_recursive_blur_reach(sd);
+	} else {
+		// temporary image
+		this->reserve_memory(small_dims);
+
+		this->reach += get_box_blur_reach(sd);
+	}
+
+	blur_surface(
+		result, //
+		s,
+		sd,
+		downscale_factor,
+		recursive ? &recursive_blur : &box_gaussian_blur,
+		this->r.num_filter_threads,
+		this->r.cancellation
+	);
+
+	// pixels around the needed region are blurred without all the source pixels they depend on
+	result.surface = result.surface.intersection(region);
 
-	this->set_result(e.result, blur_surface(s, sd));
+	this->set_result(std::move(result));
 }
 
 namespace {
-filter_result color_matrix(
-	surface& s, //
-	const r4::matrix4<real>& m,
-	const r4::vector4<real>& mc5
+void color_matrix(
+	filter_result& ret, //
+	surface& s,
+	const std::vector<color_matrix_kernel>& kernels,
+	unsigned num_threads,
+	const cancellation_token& cancellation
 )
 {
 	//	TRACE(<< "colorMatrix(): s.width = " << s.width << " s.height = " << s.height << std::endl)
 	ASSERT(!s.image_span.empty() || s.rect().d.is_zero())
-	filter_result ret(s.rect());
+	ASSERT(ret.surface.rect().d == s.rect().d)
+	ASSERT(!kernels.empty())
 
-	ASSERT(!s.image_span.empty() || s.rect().d.is_zero())
+	parallel_for_ranges(num_threads, s.rect().d.y(), s.rect().d.x(), [&](size_t begin, size_t end) {
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
 
-	for (unsigned y = 0; y != s.rect().d.y(); ++y) {
-		auto sp = s.image_span[y].data();
-		auto dp = ret.surface.image_span[y].data();
-		for (unsigned x = 0; x != s.rect().d.x(); ++x) {
-			auto cc = *sp;
-			++sp;
-
-			cc = rasterimage::unpremultiply_alpha(cc);
-
-			auto c = rasterimage::to_float<real>(cc);
-
-			ASSERT(real(0) <= c.r() && c.r() <= real(1), [&](auto& o) {
-				o << "c = " << c << ", cc = " << cc;
-			})
-			ASSERT(real(0) <= c.g() && c.g() <= real(1), [&](auto& o) {
-				o << "c = " << c << ", cc = " << cc;
-			})
-			ASSERT(real(0) <= c.b() && c.b() <= real(1), [&](auto& o) {
-				o << "c = " << c << ", cc = " << cc;
-			})
-			ASSERT(real(0) <= c.a() && c.a() <= real(1), [&](auto& o) {
-				o << "c = " << c << ", cc = " << cc;
-			})
-
-			auto c1 = m * c + mc5;
-
-			// alpha can change, so always premultiply alpha back
-			c1.r() *= c1.a();
-			c1.g() *= c1.a();
-			c1.b() *= c1.a();
-
-			using std::min;
-			c1 = min(c1, real(1)); // clamp top
-			*dp = rasterimage::to_integral<image_type::pixel_type::value_type>(c1);
-			++dp;
-		}
-	}
+			auto dst = ret.surface.image_span[y];
 
-	return ret;
+			// kernels of fused primitives are applied one after another without leaving the row
+			kernels.front().apply(dst, s.image_span[y]);
+			for (auto k = std::next(kernels.begin()); k != kernels.end(); ++k) {
+				k->apply(dst, dst);
+			}
+		}
+	});
 }
 } // namespace
 
@@ -596,191 +1096,217 @@ void filter_applier::visit(const svgdom::fe_color_matrix_element& e)
 	}
 
 	// TRACE(<< "color matrix getSource()" << std::endl)
-	auto src = this->get_source(e.in);
-	ASSERT(!src.image_span.empty())
-	auto s = src.intersection(this->filterRegion);
+	auto src = this->get_pointwise_source(e.in);
+	ASSERT(!src.surface.image_span.empty())
+	src.surface = src.surface.intersection(this->regions[this->current_primitive]);
 
-	// TODO: set filter sub-region
+	// identity matrix, e.g. hueRotate by 0 degrees, does not change the pixels
+	if (color_matrix_kernel kernel(m, mc5); kernel.get_kind() != color_matrix_kernel::kind::identity) {
+		src.kernels.push_back(std::move(kernel));
+	}
+
+	const auto& p = this->plan.get(this->current_primitive);
+	ASSERT(p)
+	if (p->fused) {
+		// the next filter primitive will apply the color matrix as part of its own pass
+		if (this->r.stats) {
+			++this->r.stats->stats.num_filter_primitives;
+		}
+		this->fused_result.emplace(this->current_primitive, std::move(src));
+		return;
+	}
+
+	if (src.kernels.empty()) {
+		// the result is a view of the input pixels, so nothing is copied
+		this->set_result(filter_result(src.surface, src.owner));
+		return;
+	}
+
+	auto result = this->make_result(src.surface.rect());
 
-	this->set_result(e.result, color_matrix(s, m, mc5));
+	color_matrix(result, src.surface, src.kernels, this->r.num_filter_threads, this->r.cancellation);
+
+	this->set_result(std::move(result));
 }
 
 namespace {
-filter_result blend(surface& in, surface& in2, svgdom::fe_blend_element::mode mode)
+// pixels of the surface row passed through the kernels of fused primitives,
+// the buffer holds the resulting pixels in case there are kernels to apply
+utki::span<const image_type::pixel_type> get_row(
+	const surface& s, //
+	const std::vector<color_matrix_kernel>& kernels,
+	unsigned y,
+	std::vector<image_type::pixel_type>& buffer
+)
+{
+	auto row = s.image_span[y];
+	if (kernels.empty()) {
+		return row;
+	}
+
+	buffer.resize(row.size());
+	auto buf = utki::make_span(buffer);
+
+	kernels.front().apply(buf, row);
+	for (auto k = std::next(kernels.begin()); k != kernels.end(); ++k) {
+		k->apply(buf, buf);
+	}
+
+	return buf;
+}
+} // namespace
+
+namespace {
+// apply per-pixel operation to overlapping area of two surfaces
+template <typename pixel_op_type>
+void combine(
+	filter_result& ret, //
+	pointwise_input& in,
+	pointwise_input& in2,
+	const pixel_op_type& op,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
 {
 	//	TRACE(<< "in.width = " << in.width << " in2.width = " << in2.width << std::endl)
-	auto s1 = in.intersection(in2.rect());
-	auto s2 = in2.intersection(in.rect());
+	auto s1 = in.surface.intersection(in2.surface.rect());
+	auto s2 = in2.surface.intersection(in.surface.rect());
 
 	ASSERT(s1.rect().d.x() == s2.rect().d.x(), [&](auto& o) {
 		o << "s1.rect().d.x() = " << s1.rect().d.x() << " s2.rect().d.x() = " << s2.rect().d.x();
 	})
 	ASSERT(s1.rect().d.y() == s2.rect().d.y())
 	ASSERT(s1.rect().p == s2.rect().p)
-
-	filter_result ret(s1.rect());
-
-	for (unsigned y = 0; y != ret.surface.rect().d.y(); ++y) {
-		auto sp1 = s1.image_span[y].data();
-		auto sp2 = s2.image_span[y].data();
-		auto dp = ret.surface.image_span[y].data();
-		for (unsigned x = 0; x != ret.surface.rect().d.x(); ++x) {
-			// TODO: optimize by using integer arithmetics instead of floating point
-			auto c01 = rasterimage::to_float<real>(*sp1);
-			++sp1;
-			auto c02 = rasterimage::to_float<real>(*sp2);
-			++sp2;
-
-			/*
-				cr = Result color (RGB) - premultiplied
-				qr = Result opacity
-				qa = Opacity value at a given pixel for image A
-				qb = Opacity value at a given pixel for image B
-				ca = Color (RGB) at a given pixel for image A - premultiplied
-				cb = Color (RGB) at a given pixel for image B - premultiplied
-			*/
-			r4::vector3<real> cr;
-			switch (mode) {
-				default:
-					ASSERT(false)
-					[[fallthrough]];
-				case svgdom::fe_blend_element::mode::normal:
-					// cr = (1 - qa) * cb + ca
-					cr = c02 * (real(1) - c01.a()) + c01;
-					break;
-				case svgdom::fe_blend_element::mode::multiply:
-					// cr = (1 - qa) * cb + (1 - qb) * ca + ca * cb
-					cr = c02 * (1 - c01.a()) + c01 * (1 - c02.a()) + c01.comp_mul(c02);
-					break;
-				case svgdom::fe_blend_element::mode::screen:
-					// cr = cb + ca - ca * cb
-					cr = c02 + c01 - c01.comp_mul(c02);
-					break;
-				case svgdom::fe_blend_element::mode::darken:
-					using std::min;
-					// cr = min((1 - qa) * cb + ca, (1 - qb) * ca + cb)
-					cr = min(c02 * (1 - c01.a()) + c01, c01 * (1 - c02.a()) + c02);
-					break;
-				case svgdom::fe_blend_element::mode::lighten:
-					using std::max;
-					// cr = max((1 - qa) * cb + ca, (1 - qb) * ca + cb)
-					cr = max(c02 * (1 - c01.a()) + c01, c01 * (1 - c02.a()) + c02);
-					break;
+	ASSERT(ret.surface.rect().d == s1.rect().d)
+
+	parallel_for_ranges(num_threads, ret.surface.rect().d.y(), ret.surface.rect().d.x(), [&](size_t begin, size_t end) {
+		std::vector<image_type::pixel_type> buffer1;
+		std::vector<image_type::pixel_type> buffer2;
+
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
+
+			auto sp1 = get_row(s1, in.kernels, y, buffer1).data();
+			auto sp2 = get_row(s2, in2.kernels, y, buffer2).data();
+			auto dp = ret.surface.image_span[y].data();
+			for (unsigned x = 0; x != ret.surface.rect().d.x(); ++x) {
+				*dp = op(*sp1, *sp2);
+				++sp1;
+				++sp2;
+				++dp;
 			}
-			// qr = 1 - (1 - qa) * (1 - qb)
-			auto qr = 1 - (1 - c01.a()) * (1 - c02.a());
-
-			*dp = rasterimage::to_integral<image_type::pixel_type::value_type>(r4::vector4<real>{cr, qr});
-			++dp;
 		}
-	}
+	});
+}
+} // namespace
 
-	return ret;
+namespace {
+void blend(
+	filter_result& ret, //
+	pointwise_input& in,
+	pointwise_input& in2,
+	svgdom::fe_blend_element::mode mode,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	using mode_type = svgdom::fe_blend_element::mode;
+
+	switch (mode) {
+		default:
+			ASSERT(false)
+			[[fallthrough]];
+		case mode_type::normal:
+			return combine(ret, in, in2, blend_op<mode_type::normal>(), num_threads, cancellation);
+		case mode_type::multiply:
+			return combine(ret, in, in2, blend_op<mode_type::multiply>(), num_threads, cancellation);
+		case mode_type::screen:
+			return combine(ret, in, in2, blend_op<mode_type::screen>(), num_threads, cancellation);
+		case mode_type::darken:
+			return combine(ret, in, in2, blend_op<mode_type::darken>(), num_threads, cancellation);
+		case mode_type::lighten:
+			return combine(ret, in, in2, blend_op<mode_type::lighten>(), num_threads, cancellation);
+	}
 }
 } // namespace
 
 void filter_applier::visit(const svgdom::fe_blend_element& e)
 {
-	auto s1 = this->get_source(e.in).intersection(this->filterRegion);
-	if (s1.image_span.empty()) {
-		return;
-	}
+	const auto& region = this->regions[this->current_primitive];
+
+	// both inputs are taken before checking them, so that a fused result is consumed in any case
+	auto s1 = this->get_pointwise_source(e.in);
+	auto s2 = this->get_pointwise_source(e.in2);
 
-	auto s2 = this->get_source(e.in2).intersection(this->filterRegion);
-	if (s2.image_span.empty()) {
+	s1.surface = s1.surface.intersection(region);
+	s2.surface = s2.surface.intersection(region);
+	if (s1.surface.image_span.empty() || s2.surface.image_span.empty()) {
 		return;
 	}
 
-	// TODO: set filter sub-region
+	auto result = this->make_pointwise_result(s1.surface.intersection(s2.surface.rect()).rect(), s1, s2);
+
+	blend(result, s1, s2, e.mode_, this->r.num_filter_threads, this->r.cancellation);
 
-	this->set_result(e.result, blend(s1, s2, e.mode_));
+	this->set_result(std::move(result));
 }
 
 namespace {
-filter_result composite(surface& in, surface& in2, const svgdom::fe_composite_element& e)
+void composite(
+	filter_result& ret, //
+	pointwise_input& in,
+	pointwise_input& in2,
+	const svgdom::fe_composite_element& e,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
 {
-	//	TRACE(<< "in.width = " << in.width << " in2.width = " << in2.width << std::endl)
-	auto s1 = in.intersection(in2.rect());
-	auto s2 = in2.intersection(in.rect());
+	using operator_type = svgdom::fe_composite_element::operator_type;
 
-	ASSERT(s1.rect().d.x() == s2.rect().d.x(), [&](auto& o) {
-		o << "s1.rect().d.x() = " << s1.rect().d.x() << " s2.rect().d.x()) = " << s2.rect().d.x();
-	})
-	ASSERT(s1.rect().d.y() == s2.rect().d.y())
-	ASSERT(s1.rect().p == s2.rect().p)
-
-	filter_result ret(s1.rect());
-
-	for (unsigned y = 0; y != ret.surface.rect().d.y(); ++y) {
-		auto sp1 = s1.image_span[y].data();
-		auto sp2 = s2.image_span[y].data();
-		auto dp = ret.surface.image_span[y].data();
-		for (unsigned x = 0; x != ret.surface.rect().d.x(); ++x) {
-			// TODO: optimize by using integer arithmetics instead of floating point
-			auto c01 = rasterimage::to_float<real>(*sp1);
-			++sp1;
-			auto c02 = rasterimage::to_float<real>(*sp2);
-			++sp2;
-
-			r4::vector4<real> o;
-			switch (e.operator_attribute) {
-				case svgdom::fe_composite_element::operator_type::over:
-					// co = as * Cs + ab * Cb * (1 – as)
-					// ao = as + ab * (1 – as)
-					o = c01 + c02 * (1 - c01.a());
-					break;
-				case svgdom::fe_composite_element::operator_type::in:
-					// co = as * Cs * ab
-					// ao = as x ab
-					o = c01 * c02.a();
-					break;
-				case svgdom::fe_composite_element::operator_type::out:
-					// co = as * Cs * (1 – ab)
-					// ao = as * (1 – ab)
-					o = c01 * (1 - c02.a());
-					break;
-				case svgdom::fe_composite_element::operator_type::atop:
-					// co = as * Cs * ab + ab * Cb * (1 – as)
-					// ao = as * ab + ab * (1 – as)
-					o = c01 * c02.a() + c02 * (1 - c01.a());
-					break;
-				case svgdom::fe_composite_element::operator_type::xor_operator:
-					// co = as * Cs * (1 - ab) + ab * Cb * (1 – as)
-					// ao = as * (1 - ab) + ab * (1 – as)
-					o = c01 * (1 - c02.a()) + c02 * (1 - c01.a());
-					break;
-				case svgdom::fe_composite_element::operator_type::arithmetic:
-					using std::min;
-					// result = k1 * i1 * i2 + k2 * i1 + k3 * i2 + k4
-					o = min(c01.comp_mul(c02) * real(e.k1) + c01 * real(e.k2) + c02 * real(e.k3) + real(e.k4), 1);
-					break;
-				default:
-					ASSERT(false)
-					break;
-			}
-
-			*dp = rasterimage::to_integral<image_type::pixel_type::value_type>(o);
-			++dp;
-		}
+	switch (e.operator_attribute) {
+		default:
+			ASSERT(false)
+			[[fallthrough]];
+		case operator_type::over:
+			return combine(ret, in, in2, composite_op<operator_type::over>(), num_threads, cancellation);
+		case operator_type::in:
+			return combine(ret, in, in2, composite_op<operator_type::in>(), num_threads, cancellation);
+		case operator_type::out:
+			return combine(ret, in, in2, composite_op<operator_type::out>(), num_threads, cancellation);
+		case operator_type::atop:
+			return combine(ret, in, in2, composite_op<operator_type::atop>(), num_threads, cancellation);
+		case operator_type::xor_operator:
+			return combine(ret, in, in2, composite_op<operator_type::xor_operator>(), num_threads, cancellation);
+		case operator_type::arithmetic:
+			return combine(
+				ret, //
+				in,
+				in2,
+				composite_arithmetic_op(real(e.k1), real(e.k2), real(e.k3), real(e.k4)),
+				num_threads,
+				cancellation
+			);
 	}
-
-	return ret;
 }
 } // namespace
 
 void filter_applier::visit(const svgdom::fe_composite_element& e)
 {
-	auto s1 = this->get_source(e.in).intersection(this->filterRegion);
-	if (s1.image_span.empty()) {
-		return;
-	}
+	const auto& region = this->regions[this->current_primitive];
 
-	auto s2 = this->get_source(e.in2).intersection(this->filterRegion);
-	if (s2.image_span.empty()) {
+	// both inputs are taken before checking them, so that a fused result is consumed in any case
+	auto s1 = this->get_pointwise_source(e.in);
+	auto s2 = this->get_pointwise_source(e.in2);
+
+	s1.surface = s1.surface.intersection(region);
+	s2.surface = s2.surface.intersection(region);
+	if (s1.surface.image_span.empty() || s2.surface.image_span.empty()) {
 		return;
 	}
 
-	// TODO: set filter sub-region
+	auto result = this->make_pointwise_result(s1.surface.intersection(s2.surface.rect()).rect(), s1, s2);
+
+	composite(result, s1, s2, e, this->r.num_filter_threads, this->r.cancellation);
 
-	this->set_result(e.result, composite(s1, s2, e));
+	this->set_result(std::move(result));
 }
@@ -29,6 +29,8 @@ SOFTWARE.
 
 #include <svgdom/visitor.hpp>
 
+#include "color_matrix.hxx"
+#include "filter_plan.hxx"
 #include "renderer.hxx"
 
 namespace svgren {
@@ -37,13 +39,43 @@ struct filter_result {
 	image_type image;
 	svgren::surface surface;
 
+	// Result which does not own its pixels is a view of pixels of another result or of a standard input.
+	// For a view of another result, this is the index of the filter primitive which owns the pixels.
+	std::optional<size_t> owner;
+
 	filter_result(r4::rectangle<unsigned> surface_rect) :
-		image(surface_rect.d),
+		filter_result(surface_rect.p, image_type(surface_rect.d))
+	{}
+
+	filter_result(r4::vector2<unsigned> position, image_type&& image) :
+		image(std::move(image)),
 		surface(
-			surface_rect.p, //
+			position, //
 			this->image.span()
 		)
 	{}
+
+	filter_result(const svgren::surface& view, std::optional<size_t> owner) :
+		image(r4::vector2<unsigned>(0)),
+		surface(view),
+		owner(owner)
+	{}
+
+	bool is_view() const noexcept
+	{
+		return this->image.pixels().empty();
+	}
+};
+
+// input of a filter primitive which works on each pixel separately
+struct pointwise_input {
+	svgren::surface surface;
+
+	// kernels of the fused feColorMatrix primitives, to be applied to the surface pixels in order
+	std::vector<color_matrix_kernel> kernels;
+
+	// index of the filter primitive which owns the surface pixels, std::nullopt for standard inputs
+	std::optional<size_t> owner;
 };
 
 class filter_applier : public svgdom::const_visitor
@@ -55,18 +87,114 @@ class filter_applier : public svgdom::const_visitor
 
 	r4::rectangle<unsigned> filterRegion = {0, std::numeric_limits<unsigned>::max()};
 
-	std::map<std::string, filter_result> results;
+	// get bounding box of the region in device space
+	r4::rectangle<real> get_region(
+		const svgdom::length& x, //
+		const svgdom::length& y,
+		const svgdom::length& width,
+		const svgdom::length& height,
+		svgdom::coordinate_units units
+	);
+
+	// get filter primitive subregion in device space, unspecified attributes default to the filter region
+	r4::rectangle<unsigned> get_subregion(
+		const svgdom::length& x, //
+		const svgdom::length& y,
+		const svgdom::length& width,
+		const svgdom::length& height
+	);
+
+	r4::vector2<real> get_blur_std_deviation(const svgdom::fe_gaussian_blur_element& e);
+
+	// gets subregion of a filter primitive and how far around its result pixels the inputs are read
+	class geometry_getter;
+
+	filter_plan plan;
+
+	// Regions of the filter primitive results which are needed by the following filter primitives
+	// or as the filter result, by index of the filter primitive. Filter primitives compute only these regions.
+	std::vector<r4::rectangle<unsigned>> regions;
+
+	// walk the filter primitives backwards and compute the needed regions
+	void plan_regions(const svgdom::filter_element& e);
 
-	filter_result* lastResult = nullptr;
+	filter_result_names names;
+
+	// index of the filter primitive being applied, among the filter element children
+	size_t current_primitive = 0;
+
+	// results of filter primitives which are still needed, by index of the filter primitive
+	std::map<size_t, filter_result> results;
+
+	// images of released results, to be reused for results of following filter primitives
+	std::vector<image_type> free_images;
+
+	// result of the fused filter primitive along with its index,
+	// it is taken by the next filter primitive
+	std::optional<std::pair<size_t, pointwise_input>> fused_result;
 
 	surface get_source(const std::string& in);
-	void set_result(const std::string& name, filter_result&& result);
+
+	// get index of the filter primitive which owns the pixels of the input,
+	// std::nullopt if the input is a standard one or a view of a standard one
+	std::optional<size_t> get_owner(const std::string& in);
+
+	pointwise_input get_pointwise_source(const std::string& in);
+	void set_result(filter_result&& result);
+
+	// create result of the current filter primitive, reusing a released image if possible,
+	// throws limit_exceeded if the filter memory limit would be exceeded
+	filter_result make_result(r4::rectangle<unsigned> rect);
+
+	// create result of the current per-pixel filter primitive, the result is written over pixels of one
+	// of the inputs if those are not needed by the following filter primitives, so that no image is allocated
+	filter_result make_pointwise_result(
+		r4::rectangle<unsigned> rect, //
+		const pointwise_input& in,
+		const pointwise_input& in2
+	);
+
+	// check if the result is needed by the following filter primitives or is the filter result
+	bool is_needed(size_t index) const;
+
+	// check if pixels of the result are shared by a view which is still needed
+	bool is_viewed(size_t index) const;
+
+	// release results which are not needed by the following filter primitives,
+	// results whose pixels are shared by needed views are kept
+	void release_dead_results();
 
 	surface get_source_graphic();
 
+	r4::vector2<unsigned> reach = 0;
+
+	// memory used by results, released images and temporary images of the current filter primitive
+	size_t memory_used = 0;
+
+	// memory used by temporary images of the current filter primitive
+	size_t temporary_memory = 0;
+
+	// account memory for images, throws limit_exceeded if the filter memory limit would be exceeded
+	void add_memory(size_t size);
+
+	// account memory for temporary images of the current filter primitive,
+	// throws limit_exceeded if the filter memory limit would be exceeded
+	void reserve_memory(r4::vector2<unsigned> dims, unsigned num_images = 1);
+
 public:
 	surface get_last_result();
 
+	/**
+	 * @brief Get filter reach.
+	 * Filter reach is the maximum distance in pixels from a pixel of the filter result
+	 * to the source pixels it depends on.
+	 * @return Reach of all the filter primitives applied so far.
+	 */
+	r4::vector2<unsigned> get_reach() const noexcept
+	{
+		return this->reach;
+	}
+
 	filter_applier(renderer& r) :
 		r(r)
 	{}
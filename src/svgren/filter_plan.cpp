@@ -0,0 +1,216 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+/* ================ LICENSE END ================ */
+
+#include "filter_plan.hxx"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include <svgdom/visitor.hpp>
+#include <utki/debug.hpp>
+
+using namespace svgren;
+
+bool svgren::is_standard_filter_input(const std::string& in)
+{
+	const std::array<std::string_view, 6> standard_inputs = {
+		"SourceGraphic",
+		"SourceAlpha",
+		"BackgroundImage",
+		"BackgroundAlpha",
+		"FillPaint",
+		"StrokePaint"
+	};
+
+	return std::find(standard_inputs.begin(), standard_inputs.end(), in) != standard_inputs.end();
+}
+
+void filter_result_names::add(const std::string& name, size_t index)
+{
+	if (!name.empty()) {
+		this->named[name] = index;
+	}
+	this->last = index;
+}
+
+std::optional<size_t> filter_result_names::resolve(const std::string& in) const
+{
+	ASSERT(!is_standard_filter_input(in))
+
+	if (in.empty()) {
+		return this->last;
+	}
+
+	auto i = this->named.find(in);
+	if (i == this->named.end()) {
+		return {};
+	}
+	return i->second;
+}
+
+namespace {
+// gets inputs and result name of supported filter primitives
+class primitive_io_getter : public svgdom::const_visitor
+{
+public:
+	bool is_primitive = false;
+
+	// the primitive works on each pixel separately
+	bool is_pointwise = false;
+
+	// the primitive can be fused into a pointwise primitive which uses its result
+	bool is_fusable = false;
+
+	std::string result;
+
+	std::vector<std::string> inputs;
+
+	void visit(const svgdom::fe_gaussian_blur_element& e) override
+	{
+		this->set(e.result, {e.in});
+	}
+
+	void visit(const svgdom::fe_color_matrix_element& e) override
+	{
+		this->set(e.result, {e.in});
+		this->is_pointwise = true;
+		this->is_fusable = true;
+	}
+
+	void visit(const svgdom::fe_blend_element& e) override
+	{
+		this->set(e.result, {e.in, e.in2});
+		this->is_pointwise = true;
+	}
+
+	void visit(const svgdom::fe_composite_element& e) override
+	{
+		this->set(e.result, {e.in, e.in2});
+		this->is_pointwise = true;
+	}
+
+private:
+	void set(const std::string& result, std::vector<std::string> inputs)
+	{
+		this->is_primitive = true;
+		this->result = result;
+		this->inputs = std::move(inputs);
+	}
+};
+} // namespace
+
+filter_plan::filter_plan(const svgdom::filter_element& filter) :
+	primitives(filter.children.size())
+{
+	filter_result_names names;
+
+	struct primitive_info {
+		bool is_pointwise = false;
+		bool is_fusable = false;
+
+		// number of uses of the result by other filter primitives
+		size_t num_uses = 0;
+
+		// index of the last filter primitive which uses the result
+		size_t last_user = 0;
+	};
+
+	std::vector<primitive_info> infos(filter.children.size());
+
+	for (size_t i = 0; i != filter.children.size(); ++i) {
+		primitive_io_getter getter;
+		filter.children[i]->accept(getter);
+
+		if (!getter.is_primitive) {
+			continue;
+		}
+
+		auto& info = infos[i];
+		info.is_pointwise = getter.is_pointwise;
+		info.is_fusable = getter.is_fusable;
+
+		std::vector<size_t> producers;
+
+		for (const auto& in : getter.inputs) {
+			if (is_standard_filter_input(in)) {
+				continue;
+			}
+
+			auto producer = names.resolve(in);
+			if (!producer) {
+				continue;
+			}
+
+			auto& p = this->primitives[*producer];
+			ASSERT(p)
+			p->last_use = i;
+
+			++infos[*producer].num_uses;
+			infos[*producer].last_user = i;
+			producers.push_back(*producer);
+		}
+
+		// result which is not used by other primitives is not needed right after it is produced
+		this->primitives[i] = primitive{getter.result, i, false, std::move(producers)};
+
+		names.add(getter.result, i);
+	}
+
+	this->last = names.get_last();
+
+	// Fused primitive reads its inputs when the primitive it is fused into is applied,
+	// so the inputs have to live until then. Primitives are walked backwards to know
+	// where the following primitive is finally applied in case of a chain of fused primitives.
+	std::vector<size_t> applied_at(filter.children.size());
+	for (size_t i = filter.children.size(); i != 0;) {
+		--i;
+		applied_at[i] = i;
+
+		auto& p = this->primitives[i];
+		if (!p) {
+			continue;
+		}
+
+		const auto& info = infos[i];
+		auto next = i + 1;
+		if (!info.is_fusable || info.num_uses != 1 || info.last_user != next || !infos[next].is_pointwise) {
+			continue;
+		}
+
+		p->fused = true;
+		applied_at[i] = applied_at[next];
+
+		for (auto producer : p->producers) {
+			auto& pp = this->primitives[producer];
+			ASSERT(pp)
+			using std::max;
+			pp->last_use = max(pp->last_use, applied_at[i]);
+		}
+	}
+}
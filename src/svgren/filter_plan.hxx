@@ -0,0 +1,151 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <svgdom/elements/filter.hpp>
+
+namespace svgren {
+
+/**
+ * @brief Check if filter primitive input refers to one of the standard inputs.
+ * Standard inputs are SourceGraphic, SourceAlpha, BackgroundImage, BackgroundAlpha, FillPaint and StrokePaint.
+ * @param in - value of 'in' or 'in2' attribute of the filter primitive.
+ * @return true if the input is a standard one.
+ * @return false if the input is a result of another filter primitive.
+ */
+bool is_standard_filter_input(const std::string& in);
+
+/**
+ * @brief Names of filter primitive results.
+ * Resolves inputs of filter primitives to the primitives which produced those.
+ * Filter primitives are identified by their index among the filter element children.
+ */
+class filter_result_names
+{
+	std::map<std::string, size_t> named;
+
+	std::optional<size_t> last;
+
+public:
+	/**
+	 * @brief Add result of a filter primitive.
+	 * @param name - result name, can be empty. Result with the same name as one of the previous results
+	 *               hides the previous one.
+	 * @param index - index of the filter primitive.
+	 */
+	void add(const std::string& name, size_t index);
+
+	/**
+	 * @brief Find filter primitive which produced the result referenced by the input.
+	 * Empty input refers to the result of the previous filter primitive.
+	 * @param in - value of 'in' or 'in2' attribute of the filter primitive, must not be a standard input.
+	 * @return Index of the filter primitive which produced the result.
+	 * @return std::nullopt if there is no such result.
+	 */
+	std::optional<size_t> resolve(const std::string& in) const;
+
+	/**
+	 * @brief Get last added result.
+	 * @return Index of the last filter primitive.
+	 * @return std::nullopt if no results were added.
+	 */
+	std::optional<size_t> get_last() const noexcept
+	{
+		return this->last;
+	}
+};
+
+/**
+ * @brief Lifetimes of filter primitive results.
+ * The plan is made before applying the filter, by walking through the filter primitives and
+ * resolving their inputs. Result of a filter primitive is not needed after its last use by
+ * another primitive, so it can be released and its memory reused.
+ * Per-pixel primitives, like feColorMatrix, which are used only by the next per-pixel primitive
+ * are fused into it, so their results are never written to memory.
+ */
+class filter_plan
+{
+public:
+	struct primitive {
+		// name of the result
+		std::string result;
+
+		// index of the last filter primitive which uses the result
+		size_t last_use;
+
+		// the result is not stored, but computed on the fly by the next filter primitive,
+		// which is its only user
+		bool fused = false;
+
+		// indices of the filter primitives which produced the inputs
+		std::vector<size_t> producers;
+	};
+
+private:
+	// filter primitives by index among the filter element children,
+	// children which are not supported filter primitives do not produce results
+	std::vector<std::optional<primitive>> primitives;
+
+	// index of the last filter primitive, its result is the filter result
+	std::optional<size_t> last;
+
+public:
+	filter_plan() = default;
+
+	filter_plan(const svgdom::filter_element& filter);
+
+	/**
+	 * @brief Get filter primitive.
+	 * @param index - index of the filter element child.
+	 * @return The filter primitive info.
+	 * @return std::nullopt if the child is not a supported filter primitive.
+	 */
+	const std::optional<primitive>& get(size_t index) const
+	{
+		return this->primitives.at(index);
+	}
+
+	/**
+	 * @brief Get last filter primitive.
+	 * Result of the last filter primitive is the result of the filter.
+	 * @return Index of the last filter primitive.
+	 * @return std::nullopt if the filter has no supported filter primitives.
+	 */
+	std::optional<size_t> get_last() const noexcept
+	{
+		return this->last;
+	}
+};
+
+} // namespace svgren
@@ -0,0 +1,279 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "parallel.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <utki/debug.hpp>
+
+using namespace svgren;
+
+unsigned svgren::get_num_threads(unsigned num_threads) noexcept
+{
+	if (num_threads != 0) {
+		return num_threads;
+	}
+
+	using std::max;
+	return max(std::thread::hardware_concurrency(), 1u);
+}
+
+namespace {
+// Work of one parallel_for() call which is shared by the calling thread and the helper threads.
+struct batch {
+	const std::function<void(size_t)>& func;
+	size_t count;
+
+	std::atomic<size_t> next_index = 0;
+	std::atomic_bool failed = false;
+
+	std::mutex exception_mutex;
+	std::exception_ptr exception;
+
+	// number of helper jobs which are queued or running, guarded by the pool mutex
+	unsigned num_pending_jobs = 0;
+	std::condition_variable jobs_finished;
+
+	batch(const std::function<void(size_t)>& func, size_t count) :
+		func(func),
+		count(count)
+	{}
+
+	// process indices until none are left
+	void work()
+	{
+		for (size_t i = this->next_index++; i < this->count && !this->failed; i = this->next_index++) {
+			try {
+				this->func(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(this->exception_mutex);
+				if (!this->exception) {
+					this->exception = std::current_exception();
+				}
+				this->failed = true;
+			}
+		}
+	}
+};
+} // namespace
+
+namespace {
+unsigned max_pool_size() noexcept
+{
+	// the calling thread is one of the threads processing the batch, so one core is left for it
+	return get_num_threads(0) - 1;
+}
+} // namespace
+
+namespace {
+// Threads which help parallel_for() callers. The threads are started on demand and are reused
+// by all subsequent calls, so that short passes, e.g. each pass of a blur, do not pay for starting threads.
+// The threads are joined when the pool is destroyed at program exit.
+class thread_pool
+{
+	std::mutex mutex;
+	std::condition_variable job_available;
+	bool stop = false;
+
+	// each job is a helper for the batch
+	std::deque<batch*> jobs;
+
+	std::vector<std::thread> threads;
+
+	void thread_main()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		for (;;) {
+			this->job_available.wait(lock, [this]() {
+				return this->stop || !this->jobs.empty();
+			});
+
+			if (this->stop) {
+				return;
+			}
+
+			auto b = this->jobs.front();
+			this->jobs.pop_front();
+
+			lock.unlock();
+			b->work();
+			lock.lock();
+
+			ASSERT(b->num_pending_jobs != 0)
+			--b->num_pending_jobs;
+			if (b->num_pending_jobs == 0) {
+				b->jobs_finished.notify_all();
+			}
+		}
+	}
+
+public:
+	thread_pool() = default;
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	thread_pool(thread_pool&&) = delete;
+	thread_pool& operator=(thread_pool&&) = delete;
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stop = true;
+		}
+		this->job_available.notify_all();
+
+		for (auto& t : this->threads) {
+			t.join();
+		}
+	}
+
+	// Process the batch by the calling thread and up to num_helpers threads of the pool.
+	// The pool never has more threads than max_pool_size(), so requests for more threads
+	// than there are CPU cores do not grow the pool, the batch is then processed by fewer threads.
+	void run(batch& b, unsigned num_helpers)
+	{
+		using std::min;
+		num_helpers = min(num_helpers, max_pool_size());
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			// Start missing threads. In case starting a thread fails, the batch is processed by
+			// the threads started so far, the calling thread alone is enough to process it.
+			// Threads which were started belong to the pool, so these are joined by the pool destructor.
+			try {
+				while (this->threads.size() < num_helpers) {
+					this->threads.emplace_back([this]() {
+						this->thread_main();
+					});
+				}
+			} catch (...) {
+				num_helpers = unsigned(min(size_t(num_helpers), this->threads.size()));
+			}
+
+			for (unsigned i = 0; i != num_helpers; ++i) {
+				this->jobs.push_back(&b);
+			}
+			b.num_pending_jobs = num_helpers;
+		}
+		this->job_available.notify_all();
+
+		b.work();
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		// All indices are taken, so the jobs which did not start yet have nothing to do. Remove them
+		// instead of waiting for them. Otherwise, nested parallel_for() calls made from the pool threads
+		// could wait for each other's jobs while no thread is free to run them.
+		auto queued = std::remove(this->jobs.begin(), this->jobs.end(), &b);
+		b.num_pending_jobs -= unsigned(std::distance(queued, this->jobs.end()));
+		this->jobs.erase(queued, this->jobs.end());
+
+		// the batch lives on the caller's stack, so wait for the running jobs to finish
+		b.jobs_finished.wait(lock, [&b]() {
+			return b.num_pending_jobs == 0;
+		});
+	}
+};
+
+thread_pool& get_pool()
+{
+	static thread_pool pool;
+	return pool;
+}
+} // namespace
+
+void svgren::parallel_for(
+	unsigned num_threads, //
+	size_t count,
+	const std::function<void(size_t)>& func
+)
+{
+	using std::min;
+	num_threads = unsigned(min(size_t(get_num_threads(num_threads)), count));
+
+	if (num_threads <= 1) {
+		for (size_t i = 0; i != count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	batch b(func, count);
+
+	get_pool().run(b, num_threads - 1);
+
+	if (b.exception) {
+		std::rethrow_exception(b.exception);
+	}
+}
+
+void svgren::parallel_for_ranges(
+	unsigned num_threads, //
+	size_t count,
+	size_t work_per_item,
+	const std::function<void(size_t begin, size_t end)>& func
+)
+{
+	using std::max;
+	using std::min;
+
+	size_t max_threads = max(count * work_per_item / min_work_per_thread, size_t(1));
+	num_threads = unsigned(min(size_t(get_num_threads(num_threads)), max_threads));
+
+	if (num_threads <= 1) {
+		func(0, count);
+		return;
+	}
+
+	// a few ranges per thread, so that threads which finish earlier pick up the remaining work
+	constexpr size_t ranges_per_thread = 4;
+
+	size_t num_ranges = min(size_t(num_threads) * ranges_per_thread, count);
+	size_t range_size = (count + num_ranges - 1) / num_ranges;
+	num_ranges = (count + range_size - 1) / range_size;
+
+	parallel_for(
+		num_threads, //
+		num_ranges,
+		[&](size_t i) {
+			size_t begin = i * range_size;
+			func(begin, min(begin + range_size, count));
+		}
+	);
+}
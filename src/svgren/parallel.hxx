@@ -0,0 +1,85 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace svgren {
+
+/**
+ * @brief Get actual number of threads to use.
+ * @param num_threads - requested number of threads, 0 means number of CPU cores.
+ * @return Number of threads to use, always greater than 0.
+ */
+unsigned get_num_threads(unsigned num_threads) noexcept;
+
+/**
+ * @brief Invoke function for each index in range [0, count) using several threads.
+ * The calling thread also participates in invoking the function.
+ * The other threads are taken from a pool of threads which is shared by all calls, the pool threads
+ * are started on first demand. The pool has at most one thread less than the number of CPU cores and
+ * never shrinks, so requesting more threads than there are CPU cores uses only that many threads.
+ * The function may itself call parallel_for().
+ * In case the function throws, the remaining indices are not processed and
+ * the first caught exception is rethrown to the caller after all threads are finished.
+ * @param num_threads - maximum number of threads to use, including calling thread.
+ * @param count - number of indices to process.
+ * @param func - function to invoke for each index.
+ */
+void parallel_for(
+	unsigned num_threads, //
+	size_t count,
+	const std::function<void(size_t)>& func
+);
+
+/**
+ * @brief Invoke function for subranges of range [0, count) using several threads.
+ * The range is split into contiguous subranges of about equal size, e.g. ranges of image rows.
+ * To avoid threading overhead for small amounts of work, the number of threads is reduced so that
+ * each thread gets at least min_work_per_thread of work.
+ * @param num_threads - maximum number of threads to use, including calling thread.
+ *                      0 means number of CPU cores.
+ * @param count - number of items, e.g. number of image rows.
+ * @param work_per_item - amount of work for one item, e.g. number of pixels in an image row.
+ * @param func - function to invoke for each subrange [begin, end).
+ */
+void parallel_for_ranges(
+	unsigned num_threads, //
+	size_t count,
+	size_t work_per_item,
+	const std::function<void(size_t begin, size_t end)>& func
+);
+
+/**
+ * @brief Minimal amount of work per thread for parallel_for_ranges().
+ * Processing of about this many pixels takes long enough to justify starting a thread.
+ */
+constexpr size_t min_work_per_thread = size_t(1) << 16;
+
+} // namespace svgren
@@ -0,0 +1,310 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include <svgdom/elements/filter.hpp>
+
+#include "config.hxx"
+
+// Integer arithmetic per-pixel operations on premultiplied 8-bit pixels.
+// Channel values are treated as fixed-point fractions with 255 meaning 1.
+
+namespace svgren {
+
+/**
+ * @brief Maximum channel value.
+ */
+constexpr unsigned channel_max = 0xff;
+
+/**
+ * @brief Rounded division by 255.
+ * Exact for all values in range [0, 255 * 255], i.e. for products of two channel values
+ * and their sums which do not exceed that range.
+ * @param v - value to divide.
+ * @return v / 255 rounded to nearest integer.
+ */
+constexpr unsigned div_255(unsigned v) noexcept
+{
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	v += 0x80;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	return (v + (v >> 8)) >> 8;
+}
+
+/**
+ * @brief Per-pixel operation of feBlend.
+ * The operation is selected at compile time, so that there is no branching on the blend mode
+ * in the pixel loop.
+ * @tparam mode - blend mode.
+ */
+template <svgdom::fe_blend_element::mode mode>
+struct blend_op {
+	/**
+	 * @brief Blend two pixels.
+	 * @param a - pixel of image A, i.e. of the 'in' input.
+	 * @param b - pixel of image B, i.e. of the 'in2' input.
+	 * @return Blended pixel.
+	 */
+	image_type::pixel_type operator()(
+		const image_type::pixel_type& a, //
+		const image_type::pixel_type& b
+	) const noexcept
+	{
+		using std::max;
+		using std::min;
+		using mode_type = svgdom::fe_blend_element::mode;
+
+		// all formulas below are multiplied by 255 to stay in integers,
+		// for premultiplied pixels the results do not exceed 255 * 255
+
+		unsigned qa = a.a();
+		unsigned qb = b.a();
+
+		image_type::pixel_type ret;
+
+		for (unsigned i = 0; i != ret.size() - 1; ++i) {
+			unsigned ca = a[i];
+			unsigned cb = b[i];
+
+			unsigned cr = 0;
+			if constexpr (mode == mode_type::normal) {
+				// cr = (1 - qa) * cb + ca
+				cr = (channel_max - qa) * cb + channel_max * ca;
+			} else if constexpr (mode == mode_type::multiply) {
+				// cr = (1 - qa) * cb + (1 - qb) * ca + ca * cb
+				cr = (channel_max - qa) * cb + (channel_max - qb) * ca + ca * cb;
+			} else if constexpr (mode == mode_type::screen) {
+				// cr = cb + ca - ca * cb
+				cr = channel_max * (cb + ca) - ca * cb;
+			} else if constexpr (mode == mode_type::darken) {
+				// cr = min((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+				cr = min((channel_max - qa) * cb + channel_max * ca, (channel_max - qb) * ca + channel_max * cb);
+			} else {
+				static_assert(mode == mode_type::lighten, "unsupported blend mode");
+				// cr = max((1 - qa) * cb + ca, (1 - qb) * ca + cb)
+				cr = max((channel_max - qa) * cb + channel_max * ca, (channel_max - qb) * ca + channel_max * cb);
+			}
+
+			// in case pixels are not correctly premultiplied the result can be out of range
+			ret[i] = uint8_t(div_255(min(cr, channel_max * channel_max)));
+		}
+
+		// qr = 1 - (1 - qa) * (1 - qb) = qa + (1 - qa) * qb
+		ret.a() = uint8_t(div_255(channel_max * qa + (channel_max - qa) * qb));
+
+		return ret;
+	}
+};
+
+/**
+ * @brief Per-pixel operation of feComposite, except the 'arithmetic' operator.
+ * The operator is selected at compile time, so that there is no branching on the operator
+ * in the pixel loop.
+ * @tparam op - composite operator.
+ */
+template <svgdom::fe_composite_element::operator_type op>
+struct composite_op {
+	/**
+	 * @brief Composite two pixels.
+	 * @param a - pixel of the 'in' input.
+	 * @param b - pixel of the 'in2' input.
+	 * @return Composited pixel.
+	 */
+	image_type::pixel_type operator()(
+		const image_type::pixel_type& a, //
+		const image_type::pixel_type& b
+	) const noexcept
+	{
+		using std::min;
+		using operator_type = svgdom::fe_composite_element::operator_type;
+
+		unsigned qa = a.a();
+		unsigned qb = b.a();
+
+		image_type::pixel_type ret;
+
+		// all channels, including alpha, are computed by the same formula, because pixels are premultiplied
+		for (unsigned i = 0; i != ret.size(); ++i) {
+			unsigned ca = a[i];
+			unsigned cb = b[i];
+
+			unsigned co = 0;
+			if constexpr (op == operator_type::over) {
+				// co = ca + cb * (1 - qa)
+				co = channel_max * ca + (channel_max - qa) * cb;
+			} else if constexpr (op == operator_type::in) {
+				// co = ca * qb
+				co = ca * qb;
+			} else if constexpr (op == operator_type::out) {
+				// co = ca * (1 - qb)
+				co = ca * (channel_max - qb);
+			} else if constexpr (op == operator_type::atop) {
+				// co = ca * qb + cb * (1 - qa)
+				co = ca * qb + cb * (channel_max - qa);
+			} else {
+				static_assert(op == operator_type::xor_operator, "unsupported composite operator");
+				// co = ca * (1 - qb) + cb * (1 - qa)
+				co = ca * (channel_max - qb) + cb * (channel_max - qa);
+			}
+
+			// in case pixels are not correctly premultiplied the result can be out of range
+			ret[i] = uint8_t(div_255(min(co, channel_max * channel_max)));
+		}
+
+		return ret;
+	}
+};
+
+/**
+ * @brief Per-pixel operation of feComposite with 'arithmetic' operator.
+ * result = k1 * i1 * i2 + k2 * i1 + k3 * i2 + k4, clamped to [0, 1].
+ * The coefficients are converted to fixed-point numbers with 16 fractional bits.
+ * Coefficients too large for the fixed-point numbers are handled in floating point.
+ */
+class composite_arithmetic_op
+{
+	// fixed-point coefficients, scaled so that the sum gives result channel value
+	int64_t k1;
+	int64_t k2;
+	int64_t k3;
+	int64_t k4;
+
+	// coefficients as given, used in case these do not fit the fixed-point numbers
+	std::array<real, 4> k;
+
+	bool is_fixed;
+
+	constexpr static unsigned fraction_bits = 16;
+
+	// Larger coefficients could overflow the fixed-point sum. Clamping such coefficients
+	// would change their ratios, e.g. k1 = 1e30 and k4 = -1e30 would no longer cancel out.
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	constexpr static real max_fixed_coefficient = real(1 << 24);
+
+	static int64_t to_fixed(real k)
+	{
+		using std::llround;
+		return llround(k * real(int64_t(1) << fraction_bits));
+	}
+
+	static bool fits_fixed(real k)
+	{
+		using std::abs;
+		// NaN does not fit
+		return abs(k) <= max_fixed_coefficient;
+	}
+
+	image_type::pixel_type apply_real(
+		const image_type::pixel_type& a, //
+		const image_type::pixel_type& b
+	) const noexcept
+	{
+		using std::lround;
+
+		image_type::pixel_type ret;
+
+		for (unsigned i = 0; i != ret.size(); ++i) {
+			real i1 = real(a[i]) / real(channel_max);
+			real i2 = real(b[i]) / real(channel_max);
+
+			// terms are grouped so that huge coefficients of opposite signs cancel out
+			// before small terms are added, e.g. k1 = -k4 = 1e30 with i1 = i2 = 1
+			real r = (this->k[0] * i1 * i2 + this->k[3]) + (this->k[1] * i1 + this->k[2] * i2);
+
+			// comparisons are false for NaN, which gives 0
+			if (!(r > 0)) {
+				ret[i] = 0;
+			} else if (r >= 1) {
+				ret[i] = uint8_t(channel_max);
+			} else {
+				ret[i] = uint8_t(lround(r * real(channel_max)));
+			}
+		}
+
+		return ret;
+	}
+
+public:
+	composite_arithmetic_op(
+		real k1, //
+		real k2,
+		real k3,
+		real k4
+	) :
+		k1(0),
+		k2(0),
+		k3(0),
+		k4(0),
+		k{k1, k2, k3, k4},
+		is_fixed(fits_fixed(k1) && fits_fixed(k2) && fits_fixed(k3) && fits_fixed(k4))
+	{
+		if (this->is_fixed) {
+			this->k1 = to_fixed(k1 / real(channel_max));
+			this->k2 = to_fixed(k2);
+			this->k3 = to_fixed(k3);
+			this->k4 = to_fixed(k4 * real(channel_max));
+		}
+	}
+
+	image_type::pixel_type operator()(
+		const image_type::pixel_type& a, //
+		const image_type::pixel_type& b
+	) const noexcept
+	{
+		using std::clamp;
+
+		if (!this->is_fixed) {
+			return this->apply_real(a, b);
+		}
+
+		image_type::pixel_type ret;
+
+		for (unsigned i = 0; i != ret.size(); ++i) {
+			int64_t ca = a[i];
+			int64_t cb = b[i];
+
+			int64_t co = this->k1 * ca * cb + this->k2 * ca + this->k3 * cb + this->k4;
+
+			// rounding, right shift of negative values rounds towards negative infinity,
+			// which is fine since those are clamped to 0 anyway
+			co = (co + (int64_t(1) << (fraction_bits - 1))) >> fraction_bits;
+
+			ret[i] = uint8_t(clamp(co, int64_t(0), int64_t(channel_max)));
+		}
+
+		return ret;
+	}
+};
+
+} // namespace svgren
@@ -0,0 +1,65 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <svgdom/dom.hpp>
+#include <svgdom/util/finder_by_id.hpp>
+#include <svgdom/util/style_stack_cache.hpp>
+
+namespace svgren {
+
+/**
+ * @brief SVG document prepared for rasterization.
+ * Rasterization needs some indexing of the SVG DOM, like finding elements by id and
+ * caching style stacks of referenced elements. The prepared document does this indexing
+ * once, so that it can be reused by any number of rasterizations of the document.
+ * The prepared document is not modified by rasterization, so it is safe to rasterize
+ * the same prepared document from several threads simultaneously.
+ *
+ * The SVG DOM must outlive the prepared document and must not be modified
+ * while the prepared document is in use.
+ */
+class prepared_document
+{
+public:
+	/**
+	 * @brief The SVG DOM.
+	 */
+	const svgdom::svg_element& svg;
+
+	const svgdom::finder_by_id finder_by_id;
+	const svgdom::style_stack_cache style_stack_cache;
+
+	/**
+	 * @brief Constructor.
+	 * @param svg - SVG DOM to prepare for rasterization.
+	 */
+	prepared_document(const svgdom::svg_element& svg);
+};
+
+} // namespace svgren
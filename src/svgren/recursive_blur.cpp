@@ -0,0 +1,334 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "recursive_blur.hxx"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <utki/debug.hpp>
+#include <utki/span.hpp>
+
+#include "parallel.hxx"
+
+using namespace svgren;
+
+namespace {
+constexpr unsigned num_channels = sizeof(image_type::pixel_type) / sizeof(image_type::pixel_type::value_type);
+
+// smallest standard deviation for which the filter coefficients are valid
+constexpr real min_std_deviation = 0.5;
+} // namespace
+
+namespace {
+// Filter coefficients. Each output value is calculated from the input value
+// and three previous output values:
+//     w[n] = b * x[n] + a1 * w[n - 1] + a2 * w[n - 2] + a3 * w[n - 3]
+// For large standard deviations the input weight b gets very small, e.g. about 1e-7 for
+// standard deviation of 200, which is below float precision. So, the coefficients and
+// the filter state are kept in double precision, only the filtered values are stored as float.
+struct coefficients {
+	double b;
+	double a1;
+	double a2;
+	double a3;
+};
+
+// Poles of the filter for standard deviation of 2, the filter for other standard deviations is obtained
+// by raising the poles to power of 1/q. The poles are the complex conjugate pair d0, conj(d0) and the real pole d1.
+// See I.T. Young, L.J. van Vliet, M. van Ginkel, "Recursive Gabor filtering", IEEE Trans. Signal Processing 50 (2002).
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+constexpr std::complex<double> base_pole_0(1.41650, 1.00829);
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+constexpr double base_pole_1 = 1.86543;
+
+// Variance of the forward-backward filter with poles scaled by q and its derivative by q.
+// Scaled pole d^(1/q) contributes 2 * d^(1/q) / (d^(1/q) - 1)^2 to the variance.
+std::pair<double, double> get_variance(double q)
+{
+	double variance = 0;
+	double derivative = 0;
+
+	auto add = [&](std::complex<double> d, double weight) {
+		auto y = std::pow(d, 1 / q);
+		auto y1 = y - 1.0;
+
+		variance += weight * std::real(2.0 * y / (y1 * y1));
+
+		// dy/dq = -y * ln(d) / q^2
+		derivative += weight * std::real(2.0 * (y + 1.0) / (y1 * y1 * y1) * y * std::log(d)) / (q * q);
+	};
+
+	// complex conjugate poles contribute complex conjugate terms, so the pair gives twice the real part
+	add(base_pole_0, 2);
+	add(base_pole_1, 1);
+
+	return {variance, derivative};
+}
+} // namespace
+
+namespace {
+// The scale q of the poles is found so that the variance of the filter response is exactly
+// the square of the standard deviation. Unlike the approximate formula for q from
+// I.T. Young, L.J. van Vliet, "Recursive implementation of the Gaussian filter", Signal Processing 44 (1995)
+// this keeps the response width right for small as well as for large standard deviations.
+coefficients make_coefficients(real std_deviation)
+{
+	using std::abs;
+	using std::max;
+
+	auto sd = double(std_deviation);
+	auto target_variance = sd * sd;
+
+	// the variance grows with q, and q is 1 for standard deviation of 2
+	double q = sd / 2;
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	for (unsigned i = 0; i != 100; ++i) {
+		auto [variance, derivative] = get_variance(q);
+		auto step = (variance - target_variance) / derivative;
+		// Newton's step must not take q to non-positive values
+		q = max(q - step, q / 2);
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		if (abs(step) <= q * 1e-12) {
+			break;
+		}
+	}
+
+	// poles of the causal filter transfer function are reciprocals of the scaled poles
+	auto p0 = 1.0 / std::pow(base_pole_0, 1 / q);
+	auto p1 = 1 / std::pow(base_pole_1, 1 / q);
+
+	// expand (1 - p0 / z) * (1 - conj(p0) / z) * (1 - p1 / z)
+	auto p0_norm = std::norm(p0);
+	auto p0_sum = 2 * p0.real();
+
+	coefficients ret{};
+	ret.a1 = p0_sum + p1;
+	ret.a2 = -(p0_norm + p0_sum * p1);
+	ret.a3 = p0_norm * p1;
+
+	// the filter gain must be 1
+	ret.b = 1 - (ret.a1 + ret.a2 + ret.a3);
+
+	return ret;
+}
+} // namespace
+
+// Filtered values are stored in a float image, values of all channels of a pixel go one after another.
+// Pixels outside of the image are assumed to be equal to the edge pixel, for such input the
+// filter is in steady state, so the output is also equal to the edge pixel. That is why the filter state
+// is initialized with the edge pixel value.
+
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+namespace {
+// filter a row of pixels in place, first forward and then backward
+void filter_row(float* row, unsigned length, const coefficients& c)
+{
+	using pixel_type = std::array<double, num_channels>;
+
+	auto filter = [&c](float* p, pixel_type& w1, pixel_type& w2, pixel_type& w3) {
+		for (unsigned ch = 0; ch != num_channels; ++ch) {
+			double w = c.b * double(p[ch]) + c.a1 * w1[ch] + c.a2 * w2[ch] + c.a3 * w3[ch];
+			p[ch] = float(w);
+			w3[ch] = w2[ch];
+			w2[ch] = w1[ch];
+			w1[ch] = w;
+		}
+	};
+
+	pixel_type w1{};
+	std::copy(row, row + num_channels, w1.begin());
+	pixel_type w2 = w1;
+	pixel_type w3 = w1;
+
+	for (unsigned n = 0; n != length; ++n) {
+		filter(row + size_t(n) * num_channels, w1, w2, w3);
+	}
+
+	// w1 holds the last output value
+	w2 = w1;
+	w3 = w1;
+
+	for (unsigned n = length; n != 0; --n) {
+		filter(row + size_t(n - 1) * num_channels, w1, w2, w3);
+	}
+}
+} // namespace
+
+namespace {
+// Filter rows in place along the columns. Filter state is kept for whole rows,
+// so the rows are processed one at a time and memory is accessed contiguously.
+class row_filter
+{
+	const coefficients& c;
+
+	// previous three output rows, w1 is the latest one
+	std::vector<double> w1;
+	std::vector<double> w2;
+	std::vector<double> w3;
+
+public:
+	row_filter(const coefficients& c, utki::span<const float> first_row) :
+		c(c),
+		w1(first_row.begin(), first_row.end()),
+		w2(this->w1),
+		w3(this->w1)
+	{}
+
+	void filter(utki::span<float> row)
+	{
+		ASSERT(row.size() == this->w1.size())
+
+		auto p = row.data();
+		auto p1 = this->w1.data();
+		auto p2 = this->w2.data();
+		auto p3 = this->w3.data();
+
+		// the oldest output row is overwritten by the new output row
+		for (size_t i = 0; i != row.size(); ++i) {
+			double w = this->c.b * double(p[i]) + this->c.a1 * p1[i] + this->c.a2 * p2[i] + this->c.a3 * p3[i];
+			p[i] = float(w);
+			p3[i] = w;
+		}
+
+		// w3 now holds the latest output row
+		std::swap(this->w3, this->w2);
+		std::swap(this->w2, this->w1);
+	}
+};
+} // namespace
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+void svgren::recursive_blur(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+)
+{
+	ASSERT(dst.dims() == src.dims())
+
+	const auto& dims = src.dims();
+
+	if (dims.is_any_zero()) {
+		return;
+	}
+
+	const size_t row_size = size_t(dims.x()) * num_channels;
+
+	std::vector<float> buf(size_t(dims.y()) * row_size);
+
+	// get part of a row of the float image, from pixel x_begin to pixel x_end
+	auto get_row = [&](unsigned y, size_t x_begin, size_t x_end) {
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+		return utki::make_span(buf.data() + y * row_size + x_begin * num_channels, (x_end - x_begin) * num_channels);
+	};
+
+	std::optional<coefficients> cx;
+	if (std_deviation.x() >= min_std_deviation) {
+		cx = make_coefficients(std_deviation.x());
+	}
+
+	// convert to float and filter horizontally, rows are independent of each other
+	parallel_for_ranges(num_threads, dims.y(), dims.x(), [&](size_t begin, size_t end) {
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
+
+			auto row = get_row(y, 0, dims.x());
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto src_row = utki::make_span(reinterpret_cast<const uint8_t*>(src[y].data()), row_size);
+			std::transform(src_row.begin(), src_row.end(), row.begin(), [](auto v) {
+				return float(v);
+			});
+
+			if (cx) {
+				filter_row(row.data(), dims.x(), *cx);
+			}
+		}
+	});
+
+	// Filter vertically, whole rows at once, so that memory is accessed contiguously.
+	// Columns are independent of each other, so each thread filters its own range of columns.
+	if (std_deviation.y() >= min_std_deviation) {
+		auto c = make_coefficients(std_deviation.y());
+
+		parallel_for_ranges(num_threads, dims.x(), dims.y(), [&](size_t begin, size_t end) {
+			// forward
+			{
+				row_filter f(c, get_row(0, begin, end));
+				for (unsigned y = 0; y != dims.y(); ++y) {
+					cancellation.check();
+					f.filter(get_row(y, begin, end));
+				}
+			}
+
+			// backward
+			{
+				row_filter f(c, get_row(dims.y() - 1, begin, end));
+				for (unsigned y = dims.y(); y != 0; --y) {
+					cancellation.check();
+					f.filter(get_row(y - 1, begin, end));
+				}
+			}
+		});
+	}
+
+	// convert back to integer pixels
+	parallel_for_ranges(num_threads, dims.y(), dims.x(), [&](size_t begin, size_t end) {
+		for (auto y = unsigned(begin); y != end; ++y) {
+			cancellation.check();
+
+			auto row = get_row(y, 0, dims.x());
+
+			// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+			auto dst_row = utki::make_span(reinterpret_cast<uint8_t*>(dst[y].data()), row_size);
+			std::transform(row.begin(), row.end(), dst_row.begin(), [](auto v) {
+				using std::clamp;
+				// value is non-negative after clamping, so adding 0.5 and truncating rounds it to nearest
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				return uint8_t(clamp(v, 0.0f, 255.0f) + 0.5f);
+			});
+
+			// Filter response may slightly overshoot, keep the pixels correctly premultiplied.
+			for (auto& px : dst[y]) {
+				for (unsigned ch = 0; ch != num_channels - 1; ++ch) {
+					using std::min;
+					px[ch] = min(px[ch], px[num_channels - 1]);
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,57 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include "cancellation_token.hxx"
+#include "config.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Recursive Gaussian blur.
+ * Implements the recursive (IIR) Gaussian filter by Young, van Vliet and van Ginkel.
+ * Unlike box blur approximation, the cost per pixel does not depend on the standard deviation.
+ * The filter response has exactly the requested standard deviation and differs from the Gaussian
+ * by about 1% of its peak value for standard deviations of 2 pixels and more.
+ * Pixels outside of the image are taken from the image edge.
+ * @param dst - destination image.
+ * @param src - source image, must be of same dimensions as destination image.
+ * @param std_deviation - standard deviation of the Gaussian in pixels, for each axis.
+ *                        Standard deviation less than 0.5 means no blur along the axis.
+ * @param num_threads - maximum number of threads to use, 0 means number of CPU cores.
+ * @param cancellation - cancellation token to check after each row.
+ */
+void recursive_blur(
+	image_span_type dst, //
+	image_span_type::const_image_span_type src,
+	r4::vector2<real> std_deviation,
+	unsigned num_threads,
+	const cancellation_token& cancellation
+);
+
+} // namespace svgren
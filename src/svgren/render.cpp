@@ -27,13 +27,20 @@ SOFTWARE.
 
 #include "render.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <mutex>
 
 #include <utki/config.hpp>
 #include <utki/util.hpp>
 #include <veg/canvas.hpp>
 
+#include "command_buffer.hxx"
 #include "config.hxx"
+#include "display_list.hpp"
+#include "limit_exceeded.hxx"
+#include "parallel.hxx"
 #include "renderer.hxx"
 
 using namespace svgren;
@@ -58,51 +65,458 @@ result svgren::render(const svgdom::svg_element& svg, const parameters& p)
 	return ret;
 }
 
-image_type svgren::rasterize(const svgdom::svg_element& svg, const parameters& params)
+namespace {
+image_type::dimensions_type calc_raster_dims(
+	const svgdom::svg_element& svg, //
+	r4::vector2<real> svg_dims,
+	const parameters& params
+)
 {
-	auto svg_dims = svg.get_dimensions(svgdom::real(params.dpi));
+	if (params.dims_request.is_zero()) {
+		using std::ceil;
+		return ceil(svg_dims).to<unsigned>();
+	}
 
-	if (!svg_dims.is_positive()) {
-		return {};
+	real aspect_ratio = svg.aspect_ratio(svgdom::real(params.dpi));
+	if (aspect_ratio == 0) {
+		return 0;
 	}
+	ASSERT(aspect_ratio > 0)
 
 	image_type::dimensions_type raster_dims;
 
-	if (params.dims_request.is_zero()) {
-		using std::ceil;
-		raster_dims = ceil(svg_dims).to<unsigned>();
+	using std::round;
+	using std::max;
+	if (params.dims_request.x() == 0 && params.dims_request.y() != 0) {
+		raster_dims.x() = unsigned(round(aspect_ratio * real(params.dims_request.y())));
+		raster_dims.x() = max(raster_dims.x(), unsigned(1)); // we don't want zero width
+		raster_dims.y() = params.dims_request.y();
+	} else if (params.dims_request.x() != 0 && params.dims_request.y() == 0) {
+		raster_dims.y() = unsigned(round(real(params.dims_request.x()) / aspect_ratio));
+		raster_dims.y() = max(raster_dims.y(), unsigned(1)); // we don't want zero height
+		raster_dims.x() = params.dims_request.x();
 	} else {
-		real aspect_ratio = svg.aspect_ratio(svgdom::real(params.dpi));
-		if (aspect_ratio == 0) {
-			return {};
+		ASSERT(params.dims_request.is_positive())
+		raster_dims = params.dims_request;
+	}
+
+	return raster_dims;
+}
+} // namespace
+
+rasterization_stats& rasterization_stats::operator+=(const rasterization_stats& s)
+{
+	this->num_elements += s.num_elements;
+	this->num_groups_pushed += s.num_groups_pushed;
+	this->num_groups_popped += s.num_groups_popped;
+	this->num_masks += s.num_masks;
+	this->num_filter_primitives += s.num_filter_primitives;
+	this->num_filter_pixels += s.num_filter_pixels;
+	this->peak_filter_memory = std::max(this->peak_filter_memory, s.peak_filter_memory);
+	this->num_path_segments += s.num_path_segments;
+	this->num_gradients += s.num_gradients;
+	this->num_fills += s.num_fills;
+	this->num_strokes += s.num_strokes;
+	this->style_time += s.style_time;
+	this->geometry_time += s.geometry_time;
+	this->fill_stroke_time += s.fill_stroke_time;
+	this->filter_time += s.filter_time;
+	this->mask_time += s.mask_time;
+	return *this;
+}
+
+namespace {
+// add statistics collected by the renderer to the requested statistics
+void add_stats(const parameters& params, const renderer& r)
+{
+	if (!params.stats) {
+		return;
+	}
+	ASSERT(r.stats)
+
+	// tiles are rendered by several threads simultaneously
+	static std::mutex mutex;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	*params.stats += r.stats->stats;
+}
+} // namespace
+
+namespace {
+// returns reach of the applied filter effects
+r4::vector2<unsigned> render_to_canvas(
+	veg::canvas& canvas, //
+	const prepared_document& doc,
+	r4::vector2<real> svg_dims,
+	image_type::dimensions_type raster_dims,
+	const parameters& params
+)
+{
+	ASSERT(svg_dims.is_positive())
+
+	canvas.scale(raster_dims.to<real>().comp_div(svg_dims));
+
+	renderer r(canvas, svg_dims, doc, params);
+
+	try {
+		doc.svg.accept(r);
+		// NOLINTNEXTLINE(bugprone-empty-catch)
+	} catch (limit_exceeded&) {
+		// rendering the root element would exceed the limits, nothing is rendered
+	}
+
+	// mask rendering errors are ignored, so cancellation during mask rendering
+	// could have gone unnoticed, check once more
+	r.cancellation.check();
+
+	add_stats(params, r);
+
+	return r.filter_reach;
+}
+} // namespace
+
+namespace {
+// Filter effects read pixels around the pixel they compute. So, when only a region of the raster image
+// is rendered, pixels near the region edges can come out wrong, unless an apron of extra pixels
+// around the region is rendered as well. The apron does not extend beyond the raster image.
+r4::rectangle<unsigned> add_apron(
+	const r4::rectangle<unsigned>& region, //
+	r4::vector2<unsigned> apron,
+	image_type::dimensions_type raster_dims
+)
+{
+	using std::min;
+	auto p1 = region.p - min(region.p, apron);
+	auto p2 = min(region.x2_y2() + apron, raster_dims);
+	return {p1, p2 - p1};
+}
+} // namespace
+
+namespace {
+// Render given rectangular region of the raster image into the destination span.
+// The dst_pos is the position of the destination span within the raster image.
+// Returns reach of the applied filter effects.
+r4::vector2<unsigned> render_region(
+	image_span_type dst, //
+	r4::vector2<unsigned> dst_pos,
+	const r4::rectangle<unsigned>& region,
+	r4::vector2<unsigned> apron,
+	const prepared_document& doc,
+	r4::vector2<real> svg_dims,
+	image_type::dimensions_type raster_dims,
+	const parameters& params
+)
+{
+	ASSERT(r4::rectangle<unsigned>(0, raster_dims).contains(region))
+	ASSERT(r4::rectangle<unsigned>(dst_pos, dst.dims()).contains(region))
+
+	auto canvas_rect = add_apron(region, apron, raster_dims);
+
+	veg::canvas canvas(canvas_rect.d);
+
+	canvas.translate(-canvas_rect.p.to<real>());
+
+	auto reach = render_to_canvas(canvas, doc, svg_dims, raster_dims, params);
+
+	dst.blit(
+		canvas.get_image_span().subspan({region.p - canvas_rect.p, region.d}), //
+		(region.p - dst_pos).to<int>()
+	);
+
+	return reach;
+}
+} // namespace
+
+namespace {
+// Render region with the given apron. If filter effects turn out to need bigger apron,
+// then the apron is enlarged and the region is rendered again.
+void render_region_with_apron(
+	image_span_type dst, //
+	r4::vector2<unsigned> dst_pos,
+	const r4::rectangle<unsigned>& region,
+	r4::vector2<unsigned>& apron,
+	const prepared_document& doc,
+	r4::vector2<real> svg_dims,
+	image_type::dimensions_type raster_dims,
+	const parameters& params
+)
+{
+	for (;;) {
+		auto reach = render_region(dst, dst_pos, region, apron, doc, svg_dims, raster_dims, params);
+
+		if (add_apron(region, apron, raster_dims).contains(add_apron(region, reach, raster_dims))) {
+			return;
 		}
-		ASSERT(aspect_ratio > 0)
-		using std::round;
+
 		using std::max;
-		if (params.dims_request.x() == 0 && params.dims_request.y() != 0) {
-			raster_dims.x() = unsigned(round(aspect_ratio * real(params.dims_request.y())));
-			raster_dims.x() = max(raster_dims.x(), unsigned(1)); // we don't want zero width
-			raster_dims.y() = params.dims_request.y();
-		} else if (params.dims_request.x() != 0 && params.dims_request.y() == 0) {
-			raster_dims.y() = unsigned(round(real(params.dims_request.x()) / aspect_ratio));
-			raster_dims.y() = max(raster_dims.y(), unsigned(1)); // we don't want zero height
-			raster_dims.x() = params.dims_request.x();
+		apron = max(apron, reach);
+	}
+}
+} // namespace
+
+namespace {
+unsigned get_num_render_threads(
+	image_type::dimensions_type dims, //
+	const parameters& params
+)
+{
+	if (params.num_threads == 1 || params.tile_dims.is_any_zero()) {
+		return 1;
+	}
+
+	if (dims.x() <= params.tile_dims.x() && dims.y() <= params.tile_dims.y()) {
+		return 1;
+	}
+
+	return get_num_threads(params.num_threads);
+}
+} // namespace
+
+namespace {
+// Render given region of the raster image by tiles in parallel.
+// The dst_pos is the position of the destination span within the raster image.
+void render_tiles(
+	image_span_type dst, //
+	r4::vector2<unsigned> dst_pos,
+	const r4::rectangle<unsigned>& region,
+	r4::vector2<unsigned>& apron,
+	const prepared_document& doc,
+	r4::vector2<real> svg_dims,
+	image_type::dimensions_type raster_dims,
+	const parameters& params,
+	unsigned num_threads
+)
+{
+	const auto& tile_dims = params.tile_dims;
+
+	ASSERT(tile_dims.is_positive())
+
+	r4::vector2<unsigned> num_tiles = {
+		(region.d.x() + tile_dims.x() - 1) / tile_dims.x(), //
+		(region.d.y() + tile_dims.y() - 1) / tile_dims.y()
+	};
+
+	auto get_tile = [&](size_t i) {
+		r4::vector2<unsigned> tile_pos = {
+			unsigned(i % num_tiles.x()), //
+			unsigned(i / num_tiles.x())
+		};
+
+		return r4::rectangle<unsigned>(region.p + tile_pos.comp_mul(tile_dims), tile_dims).intersect(region);
+	};
+
+	// render first tile by the calling thread to find out the apron needed by filter effects
+	render_region_with_apron(dst, dst_pos, get_tile(0), apron, doc, svg_dims, raster_dims, params);
+
+	parallel_for(
+		num_threads, //
+		size_t(num_tiles.x()) * size_t(num_tiles.y()) - 1,
+		[&](size_t i) {
+			auto tile_apron = apron;
+			render_region_with_apron(dst, dst_pos, get_tile(i + 1), tile_apron, doc, svg_dims, raster_dims, params);
+		}
+	);
+}
+} // namespace
+
+image_type svgren::rasterize(const svgdom::svg_element& svg, const parameters& params)
+{
+	return rasterize(prepared_document(svg), params);
+}
+
+r4::vector2<unsigned> svgren::get_raster_dims(const svgdom::svg_element& svg, const parameters& params)
+{
+	auto svg_dims = svg.get_dimensions(svgdom::real(params.dpi));
+
+	if (!svg_dims.is_positive()) {
+		return 0;
+	}
+
+	return calc_raster_dims(svg, svg_dims, params);
+}
+
+image_type svgren::rasterize(const prepared_document& doc, const parameters& params)
+{
+	const auto& svg = doc.svg;
+
+	auto svg_dims = svg.get_dimensions(svgdom::real(params.dpi));
+
+	if (!svg_dims.is_positive()) {
+		return {};
+	}
+
+	auto raster_dims = calc_raster_dims(svg, svg_dims, params);
+
+	if (!raster_dims.is_positive()) {
+		return {};
+	}
+
+	if (auto num_threads = get_num_render_threads(raster_dims, params); num_threads > 1) {
+		image_type ret(raster_dims);
+		r4::vector2<unsigned> apron = 0;
+		render_tiles(ret.span(), 0, {0, raster_dims}, apron, doc, svg_dims, raster_dims, params, num_threads);
+		return ret;
+	}
+
+	veg::canvas canvas(raster_dims);
+
+	render_to_canvas(canvas, doc, svg_dims, raster_dims, params);
+
+	return canvas.release();
+}
+
+void svgren::rasterize_bands(
+	const svgdom::svg_element& svg, //
+	unsigned band_height,
+	const band_handler_type& band_handler,
+	const parameters& params
+)
+{
+	rasterize_bands(prepared_document(svg), band_height, band_handler, params);
+}
+
+void svgren::rasterize_bands(
+	const prepared_document& doc, //
+	unsigned band_height,
+	const band_handler_type& band_handler,
+	const parameters& params
+)
+{
+	const auto& svg = doc.svg;
+
+	auto svg_dims = svg.get_dimensions(svgdom::real(params.dpi));
+
+	if (!svg_dims.is_positive()) {
+		return;
+	}
+
+	auto raster_dims = calc_raster_dims(svg, svg_dims, params);
+
+	if (!raster_dims.is_positive()) {
+		return;
+	}
+
+	using std::min;
+	band_height = band_height == 0 ? raster_dims.y() : min(band_height, raster_dims.y());
+
+	image_type band_image({raster_dims.x(), band_height});
+
+	auto num_threads = get_num_render_threads(band_image.dims(), params);
+
+	// the apron found while rendering a band is reused for the following bands
+	r4::vector2<unsigned> apron = 0;
+
+	for (unsigned y = 0; y < raster_dims.y(); y += band_height) {
+		r4::rectangle<unsigned> band = {
+			{0, y},
+			{raster_dims.x(), min(band_height, raster_dims.y() - y)}
+		};
+
+		auto span = band_image.span().subspan({0, band.d});
+
+		if (num_threads > 1) {
+			render_tiles(span, band.p, band, apron, doc, svg_dims, raster_dims, params, num_threads);
 		} else {
-			ASSERT(params.dims_request.is_positive())
-			raster_dims = params.dims_request;
+			render_region_with_apron(span, band.p, band, apron, doc, svg_dims, raster_dims, params);
 		}
+
+		band_handler(span, y);
 	}
+}
 
-	ASSERT(raster_dims.is_positive())
-	ASSERT(svg_dims.is_positive())
+image_type svgren::rasterize(const display_list& dl, const parameters& params)
+{
+	const auto& svg = dl.doc.svg;
+
+	auto p = params;
+	p.dpi = dl.dpi;
+
+	auto svg_dims = svg.get_dimensions(svgdom::real(p.dpi));
+
+	if (!svg_dims.is_positive()) {
+		return {};
+	}
+
+	auto raster_dims = calc_raster_dims(svg, svg_dims, p);
+
+	if (!raster_dims.is_positive()) {
+		return {};
+	}
 
 	veg::canvas canvas(raster_dims);
 
-	canvas.scale(raster_dims.to<real>().comp_div(svg_dims.to<real>()));
+	canvas.scale(raster_dims.to<real>().comp_div(svg_dims));
+
+	renderer r(canvas, svg_dims, dl.doc, p);
+
+	try {
+		dl.commands->replay(r);
+		// NOLINTNEXTLINE(bugprone-empty-catch)
+	} catch (limit_exceeded&) {
+		// rendering the recorded commands would exceed the limits, nothing is rendered
+	}
 
-	renderer r(canvas, params.dpi, svg_dims, svg);
+	// mask rendering errors are ignored, so cancellation during mask rendering
+	// could have gone unnoticed, check once more
+	r.cancellation.check();
 
-	svg.accept(r);
+	add_stats(p, r);
 
 	return canvas.release();
 }
+
+std::vector<image_type> svgren::rasterize(
+	const svgdom::svg_element& svg, //
+	utki::span<const parameters> params,
+	unsigned num_threads
+)
+{
+	return rasterize(prepared_document(svg), params, num_threads);
+}
+
+std::vector<image_type> svgren::rasterize(
+	const prepared_document& doc, //
+	utki::span<const parameters> params,
+	unsigned num_threads
+)
+{
+	// Display list does not depend on raster image dimensions, so compile it once per each distinct DPI.
+	// The limits and the cancellation are checked while compiling, so these have to be same too.
+	auto is_same_display_list = [](const parameters& a, const parameters& b) {
+		return a.dpi == b.dpi && a.limits.max_element_visits == b.limits.max_element_visits &&
+			a.limits.max_use_depth == b.limits.max_use_depth && a.limits.max_group_depth == b.limits.max_group_depth &&
+			a.cancel_flag == b.cancel_flag && a.deadline == b.deadline;
+	};
+
+	std::vector<display_list> display_lists;
+	std::vector<size_t> param_display_lists;
+	param_display_lists.reserve(params.size());
+
+	for (size_t i = 0; i != params.size(); ++i) {
+		const auto& p = params[i];
+
+		auto end = std::next(params.begin(), ptrdiff_t(i));
+
+		auto same = std::find_if(params.begin(), end, [&](const auto& q) {
+			return is_same_display_list(p, q);
+		});
+		if (same == end) {
+			param_display_lists.push_back(display_lists.size());
+			display_lists.emplace_back(doc, p);
+		} else {
+			param_display_lists.push_back(param_display_lists[size_t(std::distance(params.begin(), same))]);
+		}
+	}
+
+	std::vector<image_type> ret(params.size());
+
+	parallel_for(
+		num_threads, //
+		params.size(),
+		[&](size_t i) {
+			ret[i] = rasterize(display_lists[param_display_lists[i]], params[i]);
+		}
+	);
+
+	return ret;
+}
@@ -27,13 +27,184 @@ SOFTWARE.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
 #include <r4/vector.hpp>
 #include <rasterimage/image.hpp>
 #include <svgdom/dom.hpp>
+#include <utki/span.hpp>
+
+#include "prepared_document.hpp"
 
 namespace svgren {
 
 using image_type = rasterimage::image<uint8_t, 4>;
+using image_span_type = decltype(std::declval<image_type>().span());
+
+/**
+ * @brief Rasterization complexity limits.
+ * The limits bound the amount of work and memory a single SVG document can cause, which
+ * is useful when rasterizing untrusted SVG documents. When rendering of an element would exceed
+ * a limit, the element along with all its children is skipped and the rasterization
+ * continues with the rest of the document.
+ * By default there are no limits.
+ */
+struct rasterization_limits {
+	/**
+	 * @brief Maximum number of elements to render.
+	 */
+	unsigned max_element_visits = std::numeric_limits<unsigned>::max();
+
+	/**
+	 * @brief Maximum depth of nested <use> element references.
+	 */
+	unsigned max_use_depth = std::numeric_limits<unsigned>::max();
+
+	/**
+	 * @brief Maximum depth of nested groups.
+	 * Groups are rendered on separate temporary images, e.g. for elements with opacity, masks or filters.
+	 */
+	unsigned max_group_depth = std::numeric_limits<unsigned>::max();
+
+	/**
+	 * @brief Maximum box blur size in pixels.
+	 * Gaussian blur is approximated by box blur with box size of about 1.88 of the standard deviation.
+	 */
+	unsigned max_blur_size = std::numeric_limits<unsigned>::max();
+
+	/**
+	 * @brief Maximum memory in bytes for temporary images of a filter effect.
+	 * The limit applies to each rendered image region, i.e. to each tile or band in case of tiled
+	 * or band-by-band rasterization.
+	 */
+	size_t max_filter_memory = std::numeric_limits<size_t>::max();
+};
+
+/**
+ * @brief Rasterization statistics.
+ * Describes the work done by rasterization, useful for finding out why some SVG documents
+ * take long to rasterize.
+ */
+struct rasterization_stats {
+	/**
+	 * @brief Number of rendered elements.
+	 */
+	size_t num_elements = 0;
+
+	/**
+	 * @brief Number of groups pushed.
+	 * Groups are rendered on separate temporary images, e.g. for elements with opacity, masks or filters.
+	 */
+	size_t num_groups_pushed = 0;
+
+	/**
+	 * @brief Number of groups popped.
+	 */
+	size_t num_groups_popped = 0;
+
+	/**
+	 * @brief Number of applied masks.
+	 */
+	size_t num_masks = 0;
+
+	/**
+	 * @brief Number of executed filter primitives.
+	 */
+	size_t num_filter_primitives = 0;
+
+	/**
+	 * @brief Total number of pixels in results of the executed filter primitives.
+	 * Results which are views of pixels of other images are counted by their region too.
+	 */
+	size_t num_filter_pixels = 0;
+
+	/**
+	 * @brief Peak memory in bytes used by images of a filter effect.
+	 * The largest amount over all applied filter effects, so adding statistics takes the maximum.
+	 */
+	size_t peak_filter_memory = 0;
+
+	/**
+	 * @brief Number of emitted path segments.
+	 * Basic shapes, like circle or rectangle, are counted as one segment.
+	 */
+	size_t num_path_segments = 0;
+
+	/**
+	 * @brief Number of built gradients.
+	 */
+	size_t num_gradients = 0;
+
+	/**
+	 * @brief Number of shape fills.
+	 */
+	size_t num_fills = 0;
+
+	/**
+	 * @brief Number of shape strokes.
+	 */
+	size_t num_strokes = 0;
+
+	// Time spent in different rasterization stages. The times are exclusive, e.g. time of filling
+	// a shape is accounted to fill_stroke_time and not to geometry_time of the shape.
+
+	/**
+	 * @brief Time spent in resolving styles and paints.
+	 */
+	std::chrono::nanoseconds style_time{0};
+
+	/**
+	 * @brief Time spent in building shape geometry.
+	 */
+	std::chrono::nanoseconds geometry_time{0};
+
+	/**
+	 * @brief Time spent in filling and stroking shapes.
+	 */
+	std::chrono::nanoseconds fill_stroke_time{0};
+
+	/**
+	 * @brief Time spent in applying filter effects.
+	 */
+	std::chrono::nanoseconds filter_time{0};
+
+	/**
+	 * @brief Time spent in applying masks.
+	 */
+	std::chrono::nanoseconds mask_time{0};
+
+	rasterization_stats& operator+=(const rasterization_stats& s);
+};
+
+/**
+ * @brief Gaussian blur algorithm.
+ */
+enum class blur_algorithm {
+	/**
+	 * @brief Select the algorithm automatically.
+	 * Box blur is used unless the recursive blur would be faster, which is the case
+	 * when the blur is much wider than the blurred image region.
+	 */
+	automatic,
+
+	/**
+	 * @brief Three successive box blurs.
+	 * This is the approximation recommended by the SVG specification.
+	 * The cost per pixel grows slightly with the standard deviation.
+	 */
+	box,
+
+	/**
+	 * @brief Recursive (IIR) Gaussian filter.
+	 * The cost per pixel does not depend on the standard deviation.
+	 * Needs temporary memory of four times the blurred image size.
+	 */
+	recursive
+};
 
 /**
  * @brief SVG render parameters.
@@ -53,6 +224,109 @@ struct parameters {
 	 * @brief Dots per inch to use for unit conversion to pixels.
 	 */
 	unsigned dpi = default_dpi;
+
+	/**
+	 * @brief Number of threads to use for rasterization.
+	 * If greater than 1, then the raster image is split into tiles which are
+	 * rasterized in parallel by the given number of threads.
+	 * 0 means use as many threads as there are CPU cores.
+	 */
+	unsigned num_threads = 1;
+
+	constexpr static auto default_tile_size = 256;
+
+	/**
+	 * @brief Dimensions of a tile for multithreaded rasterization.
+	 */
+	r4::vector2<unsigned> tile_dims = default_tile_size;
+
+	/**
+	 * @brief Number of threads to use for filter effects.
+	 * Filter effect primitives, like blur, process rows or columns of an image in parallel
+	 * using the given number of threads. Small images are processed by single thread.
+	 * 0 means use as many threads as there are CPU cores.
+	 * With num_threads greater than 1 the tiles are already rasterized in parallel,
+	 * so it makes sense to keep this at 1 in that case to not oversubscribe the CPU cores.
+	 */
+	unsigned num_filter_threads = 1;
+
+	/**
+	 * @brief Cancellation flag.
+	 * If not null, the rasterization regularly checks the flag and aborts by throwing
+	 * svgren::canceled exception as soon as the flag is set to true.
+	 * The flag can be set from any thread. The flag must outlive the rasterization.
+	 */
+	const std::atomic_bool* cancel_flag = nullptr;
+
+	/**
+	 * @brief Rasterization deadline.
+	 * The rasterization regularly checks the time and aborts by throwing
+	 * svgren::deadline_exceeded exception as soon as the deadline has passed.
+	 * By default there is no deadline.
+	 */
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+	/**
+	 * @brief Rasterization complexity limits.
+	 */
+	rasterization_limits limits;
+
+	/**
+	 * @brief Algorithm for feGaussianBlur filter primitive.
+	 */
+	blur_algorithm blur = blur_algorithm::automatic;
+
+	/**
+	 * @brief Allow blurring at reduced resolution.
+	 * Blurs with large standard deviation leave no fine details in the image, so these can be done
+	 * on a downscaled image and then upscaled back, which takes much less time and memory.
+	 * This is done for standard deviations of 16 pixels and more. Each channel value of the result differs
+	 * from the result of blurring at full resolution by at most 8, except for areas near
+	 * the filter region edges where the image content is not transparent.
+	 * This applies to both blur algorithms.
+	 */
+	bool blur_downscaling = true;
+
+	/**
+	 * @brief Release filter primitive results as soon as no following primitive uses them.
+	 * Memory of released results is reused for results of the following primitives, and per-pixel
+	 * primitives write their results over inputs which are not used anymore. The resulting image
+	 * is the same either way, turning this off only makes filter effects take more memory.
+	 * This is for checking the memory savings, see rasterization_stats::peak_filter_memory.
+	 */
+	bool filter_result_release = true;
+
+	/**
+	 * @brief Rasterization statistics.
+	 * If not null, statistics of the rasterization are added to the pointed struct.
+	 * Collecting statistics makes rasterization a bit slower.
+	 * The struct must outlive the rasterization.
+	 */
+	rasterization_stats* stats = nullptr;
+};
+
+/**
+ * @brief Rasterization canceled exception.
+ * Thrown when the rasterization is aborted because parameters::cancel_flag is set.
+ */
+class canceled : public std::runtime_error
+{
+public:
+	canceled(const std::string& message = "rasterization canceled") :
+		std::runtime_error(message)
+	{}
+};
+
+/**
+ * @brief Rasterization deadline exceeded exception.
+ * Thrown when the rasterization is aborted because parameters::deadline has passed.
+ */
+class deadline_exceeded : public canceled
+{
+public:
+	deadline_exceeded() :
+		canceled("rasterization deadline exceeded")
+	{}
 };
 
 /**
@@ -80,10 +354,116 @@ struct result {
 
 /**
  * @brief Create raster image from given SVG DOM.
+ * The raster image is always allocated by the rasterizer, rendering into caller-owned memory
+ * is not supported, because veg::canvas owns its render target.
  * @param svg - SVG DOM to rasterize.
  * @param params - rasterization parameters.
  * @return Raster image of the SVG.
+ * @throw svgren::canceled - in case the rasterization was canceled via parameters::cancel_flag.
+ * @throw svgren::deadline_exceeded - in case the parameters::deadline has passed.
  */
 image_type rasterize(const svgdom::svg_element& svg, const parameters& params = parameters());
 
+/**
+ * @brief Get dimensions of the raster image which rasterize() would create.
+ * Useful for knowing the raster image dimensions before rasterize_bands() hands out the first band.
+ * @param svg - SVG DOM.
+ * @param params - rasterization parameters.
+ * @return Dimensions of the raster image.
+ * @return Zero dimensions if the SVG has no size.
+ */
+r4::vector2<unsigned> get_raster_dims(const svgdom::svg_element& svg, const parameters& params = parameters());
+
+/**
+ * @brief Band handler function.
+ * The function receives the rendered band and the y position of the band's top edge within the raster image.
+ * The band image span is valid only during the handler call.
+ */
+using band_handler_type = std::function<void(image_span_type band, unsigned y)>;
+
+/**
+ * @brief Rasterize SVG band by band.
+ * The raster image is rendered by horizontal bands from top to bottom. Each finished band is handed to
+ * the band handler before the next band is rendered, so the whole raster image never needs to be in memory.
+ * Memory used for rendering is proportional to the band height rather than to the raster image height.
+ * Filter effects need some pixels above and below the band, so for documents with filter effects
+ * each band is rendered with an overlap of the size needed by the filters.
+ * The raster image dimensions are determined same way as by rasterize(), see get_raster_dims().
+ * @param svg - SVG DOM to rasterize.
+ * @param band_height - height of the bands in pixels. The last band can be lower.
+ *                      0 means render the whole image as one band.
+ * @param band_handler - function to call for each rendered band.
+ * @param params - rasterization parameters.
+ */
+void rasterize_bands(
+	const svgdom::svg_element& svg, //
+	unsigned band_height,
+	const band_handler_type& band_handler,
+	const parameters& params = parameters()
+);
+
+/**
+ * @brief Rasterize prepared SVG document band by band.
+ * Same as rasterize_bands(const svgdom::svg_element&, unsigned, const band_handler_type&, const parameters&),
+ * but does not repeat the SVG DOM indexing which is already done by the prepared document.
+ * @param doc - prepared SVG document to rasterize.
+ * @param band_height - height of the bands in pixels. The last band can be lower.
+ *                      0 means render the whole image as one band.
+ * @param band_handler - function to call for each rendered band.
+ * @param params - rasterization parameters.
+ */
+void rasterize_bands(
+	const prepared_document& doc, //
+	unsigned band_height,
+	const band_handler_type& band_handler,
+	const parameters& params = parameters()
+);
+
+/**
+ * @brief Create raster image from prepared SVG document.
+ * Same as rasterize(const svgdom::svg_element&, const parameters&), but does not
+ * repeat the SVG DOM indexing which is already done by the prepared document.
+ * @param doc - prepared SVG document to rasterize.
+ * @param params - rasterization parameters.
+ * @return Raster image of the SVG.
+ */
+image_type rasterize(const prepared_document& doc, const parameters& params = parameters());
+
+/**
+ * @brief Create several raster images of the same SVG.
+ * This is useful for rendering the same image in several sizes, e.g. an icon set.
+ * All the size independent work, like indexing the SVG DOM, resolving styles, paints and path geometry,
+ * is done once and shared by all the raster images.
+ * @param svg - SVG DOM to rasterize.
+ * @param params - rasterization parameters, one per resulting raster image.
+ * @param num_threads - number of threads to rasterize the images concurrently,
+ *                      0 means use as many threads as there are CPU cores.
+ * @return Raster images of the SVG, one per given rasterization parameters, in the same order.
+ * @throw svgren::canceled - in case the rasterization was canceled via parameters::cancel_flag.
+ * @throw svgren::deadline_exceeded - in case the parameters::deadline has passed.
+ */
+std::vector<image_type> rasterize(
+	const svgdom::svg_element& svg, //
+	utki::span<const parameters> params,
+	unsigned num_threads = 1
+);
+
+/**
+ * @brief Create several raster images of the same prepared SVG document.
+ * Same as rasterize(const svgdom::svg_element&, utki::span<const parameters>, unsigned), but does not
+ * repeat the SVG DOM indexing which is already done by the prepared document.
+ * @param doc - prepared SVG document to rasterize.
+ * @param params - rasterization parameters, one per resulting raster image.
+ * @param num_threads - number of threads to rasterize the images concurrently,
+ *                      0 means use as many threads as there are CPU cores.
+ * @return Raster images of the SVG, one per given rasterization parameters, in the same order.
+ * @throw svgren::canceled - in case the rasterization was canceled via parameters::cancel_flag.
+ * @throw svgren::deadline_exceeded - in case the parameters::deadline has passed.
+ */
+std::vector<image_type> rasterize(
+	const prepared_document& doc, //
+	utki::span<const parameters> params,
+	unsigned num_threads = 1
+);
+
 } // namespace svgren
@@ -0,0 +1,440 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#include "render_canvas.hxx"
+
+#include <utki/debug.hpp>
+
+using namespace svgren;
+
+void render_canvas::record(opcode op)
+{
+	ASSERT(this->recording)
+
+	if (this->matrix_changed) {
+		this->matrix_changed = false;
+
+		this->recording->opcodes.push_back(opcode::set_matrix);
+		for (const auto& row : this->target.get_matrix()) {
+			for (const auto& e : row) {
+				this->recording->values.push_back(e);
+			}
+		}
+	}
+
+	this->recording->opcodes.push_back(op);
+}
+
+void render_canvas::record(opcode op, std::initializer_list<real> values)
+{
+	this->record(op);
+	this->recording->values.insert(this->recording->values.end(), values);
+}
+
+void render_canvas::set_matrix(const matrix_type& m)
+{
+	this->target.set_matrix(m);
+	this->matrix_changed = true;
+}
+
+void render_canvas::transform(const matrix_type& m)
+{
+	this->target.transform(m);
+	this->matrix_changed = true;
+}
+
+void render_canvas::translate(real x, real y)
+{
+	this->target.translate(x, y);
+	this->matrix_changed = true;
+}
+
+void render_canvas::translate(const r4::vector2<real>& v)
+{
+	this->target.translate(v);
+	this->matrix_changed = true;
+}
+
+void render_canvas::scale(real x, real y)
+{
+	this->target.scale(x, y);
+	this->matrix_changed = true;
+}
+
+void render_canvas::scale(const r4::vector2<real>& v)
+{
+	this->target.scale(v);
+	this->matrix_changed = true;
+}
+
+void render_canvas::rotate(real radians)
+{
+	this->target.rotate(radians);
+	this->matrix_changed = true;
+}
+
+void render_canvas::move_abs(const r4::vector2<real>& p)
+{
+	this->target.move_abs(p);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::move_abs, {p.x(), p.y()});
+	}
+}
+
+void render_canvas::move_rel(const r4::vector2<real>& p)
+{
+	this->target.move_rel(p);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::move_rel, {p.x(), p.y()});
+	}
+}
+
+void render_canvas::line_abs(const r4::vector2<real>& p)
+{
+	this->target.line_abs(p);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::line_abs, {p.x(), p.y()});
+	}
+}
+
+void render_canvas::line_rel(const r4::vector2<real>& p)
+{
+	this->target.line_rel(p);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::line_rel, {p.x(), p.y()});
+	}
+}
+
+void render_canvas::quadratic_curve_abs(const r4::vector2<real>& cp, const r4::vector2<real>& ep)
+{
+	this->target.quadratic_curve_abs(cp, ep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::quadratic_curve_abs, {cp.x(), cp.y(), ep.x(), ep.y()});
+	}
+}
+
+void render_canvas::quadratic_curve_rel(const r4::vector2<real>& cp, const r4::vector2<real>& ep)
+{
+	this->target.quadratic_curve_rel(cp, ep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::quadratic_curve_rel, {cp.x(), cp.y(), ep.x(), ep.y()});
+	}
+}
+
+void render_canvas::cubic_curve_abs(
+	const r4::vector2<real>& cp1, //
+	const r4::vector2<real>& cp2,
+	const r4::vector2<real>& ep
+)
+{
+	this->target.cubic_curve_abs(cp1, cp2, ep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::cubic_curve_abs, {cp1.x(), cp1.y(), cp2.x(), cp2.y(), ep.x(), ep.y()});
+	}
+}
+
+void render_canvas::cubic_curve_rel(
+	const r4::vector2<real>& cp1, //
+	const r4::vector2<real>& cp2,
+	const r4::vector2<real>& ep
+)
+{
+	this->target.cubic_curve_rel(cp1, cp2, ep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::cubic_curve_rel, {cp1.x(), cp1.y(), cp2.x(), cp2.y(), ep.x(), ep.y()});
+	}
+}
+
+void render_canvas::arc_abs(
+	const r4::vector2<real>& end_point, //
+	const r4::vector2<real>& radius,
+	real x_axis_rotation,
+	bool large_arc,
+	bool sweep
+)
+{
+	this->target.arc_abs(end_point, radius, x_axis_rotation, large_arc, sweep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(
+			opcode::arc_abs,
+			{end_point.x(), end_point.y(), radius.x(), radius.y(), x_axis_rotation, real(large_arc), real(sweep)}
+		);
+	}
+}
+
+void render_canvas::arc_rel(
+	const r4::vector2<real>& end_point, //
+	const r4::vector2<real>& radius,
+	real x_axis_rotation,
+	bool large_arc,
+	bool sweep
+)
+{
+	this->target.arc_rel(end_point, radius, x_axis_rotation, large_arc, sweep);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(
+			opcode::arc_rel,
+			{end_point.x(), end_point.y(), radius.x(), radius.y(), x_axis_rotation, real(large_arc), real(sweep)}
+		);
+	}
+}
+
+void render_canvas::arc_abs(
+	const r4::vector2<real>& center, //
+	const r4::vector2<real>& radius,
+	real start_angle,
+	real sweep_angle
+)
+{
+	this->target.arc_abs(center, radius, start_angle, sweep_angle);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::arc_abs_angles, {center.x(), center.y(), radius.x(), radius.y(), start_angle, sweep_angle});
+	}
+}
+
+void render_canvas::close_path()
+{
+	this->target.close_path();
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::close_path);
+	}
+}
+
+void render_canvas::circle(const r4::vector2<real>& center, real radius)
+{
+	this->target.circle(center, radius);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::circle, {center.x(), center.y(), radius});
+	}
+}
+
+void render_canvas::rectangle(const r4::rectangle<real>& rect)
+{
+	this->target.rectangle(rect);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(opcode::rectangle, {rect.p.x(), rect.p.y(), rect.d.x(), rect.d.y()});
+	}
+}
+
+void render_canvas::rectangle(const r4::rectangle<real>& rect, const r4::vector2<real>& corner_radius)
+{
+	this->target.rectangle(rect, corner_radius);
+	this->count_path_segment();
+	if (this->recording) {
+		this->record(
+			opcode::rounded_rectangle,
+			{rect.p.x(), rect.p.y(), rect.d.x(), rect.d.y(), corner_radius.x(), corner_radius.y()}
+		);
+	}
+}
+
+void render_canvas::clear_path()
+{
+	this->target.clear_path();
+	if (this->recording) {
+		this->record(opcode::clear_path);
+	}
+}
+
+void render_canvas::fill()
+{
+	if (this->recording) {
+		this->record(opcode::fill);
+		return;
+	}
+
+	stats_stage_scope stage_scope(this->stats, &rasterization_stats::fill_stroke_time);
+	if (this->stats) {
+		++this->stats->stats.num_fills;
+	}
+
+	this->target.fill();
+}
+
+void render_canvas::stroke()
+{
+	if (this->recording) {
+		this->record(opcode::stroke);
+		return;
+	}
+
+	stats_stage_scope stage_scope(this->stats, &rasterization_stats::fill_stroke_time);
+	if (this->stats) {
+		++this->stats->stats.num_strokes;
+	}
+
+	this->target.stroke();
+}
+
+void render_canvas::set_source(const r4::vector4<real>& color)
+{
+	if (this->recording) {
+		this->record(opcode::set_source_color, {color.r(), color.g(), color.b(), color.a()});
+		return;
+	}
+	this->target.set_source(color);
+}
+
+void render_canvas::set_source(const gradient_paint& gradient)
+{
+	if (this->recording) {
+		// gradient takes the current matrix, so make sure it is recorded
+		this->record(opcode::set_source_gradient);
+		this->recording->gradients.push_back(gradient);
+		return;
+	}
+	if (this->stats) {
+		++this->stats->stats.num_gradients;
+	}
+	this->target.set_source(gradient.make_gradient());
+}
+
+void render_canvas::set_fill_rule(veg::fill_rule fr)
+{
+	if (this->recording) {
+		this->record(opcode::set_fill_rule, {real(unsigned(fr))});
+		return;
+	}
+	this->target.set_fill_rule(fr);
+}
+
+void render_canvas::set_line_width(real width)
+{
+	if (this->recording) {
+		this->record(opcode::set_line_width, {width});
+		return;
+	}
+	this->target.set_line_width(width);
+}
+
+void render_canvas::set_line_cap(veg::line_cap lc)
+{
+	if (this->recording) {
+		this->record(opcode::set_line_cap, {real(unsigned(lc))});
+		return;
+	}
+	this->target.set_line_cap(lc);
+}
+
+void render_canvas::set_line_join(veg::line_join lj)
+{
+	if (this->recording) {
+		this->record(opcode::set_line_join, {real(unsigned(lj))});
+		return;
+	}
+	this->target.set_line_join(lj);
+}
+
+void render_canvas::set_dash_pattern(utki::span<const real> dashes, real offset)
+{
+	if (this->recording) {
+		this->record(opcode::set_dash_pattern, {real(dashes.size())});
+		auto& values = this->recording->values;
+		values.insert(values.end(), dashes.begin(), dashes.end());
+		values.push_back(offset);
+		return;
+	}
+	this->target.set_dash_pattern(dashes, offset);
+}
+
+void render_canvas::push_group()
+{
+	if (this->recording) {
+		this->record(opcode::push_group);
+		return;
+	}
+	if (this->stats) {
+		++this->stats->stats.num_groups_pushed;
+	}
+	this->target.push_group();
+}
+
+void render_canvas::pop_group(real opacity)
+{
+	if (this->recording) {
+		this->record(opcode::pop_group, {opacity});
+		return;
+	}
+	if (this->stats) {
+		++this->stats->stats.num_groups_popped;
+	}
+	this->target.pop_group(opacity);
+}
+
+void render_canvas::pop_mask_and_group()
+{
+	if (this->recording) {
+		this->record(opcode::pop_mask_and_group);
+		return;
+	}
+
+	stats_stage_scope stage_scope(this->stats, &rasterization_stats::mask_time);
+	if (this->stats) {
+		++this->stats->stats.num_masks;
+		// both the mask group and the masked group are popped
+		this->stats->stats.num_groups_popped += 2;
+	}
+
+	this->target.pop_mask_and_group();
+}
+
+void render_canvas::mark_background_push()
+{
+	if (this->recording) {
+		this->record(opcode::push_background);
+	}
+}
+
+void render_canvas::mark_background_pop()
+{
+	if (this->recording) {
+		this->record(opcode::pop_background);
+	}
+}
+
+void render_canvas::record_filter(filter_application filter)
+{
+	ASSERT(this->recording)
+
+	// filter uses the current matrix, so make sure it is recorded
+	this->record(opcode::apply_filter);
+	this->recording->filters.push_back(std::move(filter));
+}
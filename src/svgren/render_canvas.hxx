@@ -0,0 +1,235 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <type_traits>
+
+#include <r4/rectangle.hpp>
+#include <utki/span.hpp>
+#include <veg/canvas.hpp>
+
+#include "command_buffer.hxx"
+#include "config.hxx"
+#include "stats.hxx"
+
+namespace svgren {
+
+/**
+ * @brief Canvas used by the renderer.
+ * Forwards all calls to the veg::canvas. In recording mode the drawing calls are
+ * recorded to the command buffer instead of drawing, while the path and matrix calls
+ * are still forwarded, so that the renderer is able to query current point, bounding box
+ * and matrix.
+ */
+class render_canvas
+{
+	veg::canvas& target;
+
+	command_buffer* recording = nullptr;
+
+	// whether the matrix has changed since it was last recorded
+	bool matrix_changed = true;
+
+	stats_collector* stats = nullptr;
+
+	void record(opcode op);
+	void record(opcode op, std::initializer_list<real> values);
+
+	void count_path_segment() noexcept
+	{
+		if (this->stats) {
+			++this->stats->stats.num_path_segments;
+		}
+	}
+
+public:
+	using matrix_type = std::decay_t<decltype(std::declval<veg::canvas&>().get_matrix())>;
+
+	render_canvas(veg::canvas& target) :
+		target(target)
+	{}
+
+	/**
+	 * @brief Start recording drawing calls.
+	 * @param buffer - command buffer to record to.
+	 */
+	void start_recording(command_buffer& buffer) noexcept
+	{
+		this->recording = &buffer;
+		this->matrix_changed = true;
+	}
+
+	bool is_recording() const noexcept
+	{
+		return this->recording != nullptr;
+	}
+
+	/**
+	 * @brief Start collecting statistics of drawing calls.
+	 * @param collector - statistics collector.
+	 */
+	void collect_stats(stats_collector& collector) noexcept
+	{
+		this->stats = &collector;
+	}
+
+	// queries
+
+	image_span_type get_image_span()
+	{
+		return this->target.get_image_span();
+	}
+
+	matrix_type get_matrix() const
+	{
+		return this->target.get_matrix();
+	}
+
+	r4::vector2<real> matrix_mul(const r4::vector2<real>& v) const
+	{
+		return this->target.matrix_mul(v);
+	}
+
+	r4::vector2<real> matrix_mul_distance(const r4::vector2<real>& v) const
+	{
+		return this->target.matrix_mul_distance(v);
+	}
+
+	r4::vector2<real> get_current_point() const
+	{
+		return this->target.get_current_point();
+	}
+
+	r4::rectangle<real> get_shape_bounding_box() const
+	{
+		return this->target.get_shape_bounding_box();
+	}
+
+	// matrix
+
+	void set_matrix(const matrix_type& m);
+	void transform(const matrix_type& m);
+	void translate(real x, real y);
+	void translate(const r4::vector2<real>& v);
+	void scale(real x, real y);
+	void scale(const r4::vector2<real>& v);
+	void rotate(real radians);
+
+	// path
+
+	void move_abs(const r4::vector2<real>& p);
+	void move_rel(const r4::vector2<real>& p);
+	void line_abs(const r4::vector2<real>& p);
+	void line_rel(const r4::vector2<real>& p);
+	void quadratic_curve_abs(const r4::vector2<real>& cp, const r4::vector2<real>& ep);
+	void quadratic_curve_rel(const r4::vector2<real>& cp, const r4::vector2<real>& ep);
+	void cubic_curve_abs(const r4::vector2<real>& cp1, const r4::vector2<real>& cp2, const r4::vector2<real>& ep);
+	void cubic_curve_rel(const r4::vector2<real>& cp1, const r4::vector2<real>& cp2, const r4::vector2<real>& ep);
+	void arc_abs(
+		const r4::vector2<real>& end_point, //
+		const r4::vector2<real>& radius,
+		real x_axis_rotation,
+		bool large_arc,
+		bool sweep
+	);
+	void arc_rel(
+		const r4::vector2<real>& end_point, //
+		const r4::vector2<real>& radius,
+		real x_axis_rotation,
+		bool large_arc,
+		bool sweep
+	);
+	void arc_abs(
+		const r4::vector2<real>& center, //
+		const r4::vector2<real>& radius,
+		real start_angle,
+		real sweep_angle
+	);
+	void close_path();
+	void circle(const r4::vector2<real>& center, real radius);
+	void rectangle(const r4::rectangle<real>& rect);
+	void rectangle(const r4::rectangle<real>& rect, const r4::vector2<real>& corner_radius);
+	void clear_path();
+
+	// drawing
+
+	void fill();
+	void stroke();
+
+	void set_source(const r4::vector4<real>& color);
+	void set_source(const gradient_paint& gradient);
+	void set_fill_rule(veg::fill_rule fr);
+	void set_line_width(real width);
+	void set_line_cap(veg::line_cap lc);
+	void set_line_join(veg::line_join lj);
+	void set_dash_pattern(utki::span<const real> dashes, real offset);
+
+	void push_group();
+	void pop_group(real opacity);
+	void pop_mask_and_group();
+
+	// markers, these only record the command and do nothing when not recording
+
+	void mark_background_push();
+	void mark_background_pop();
+
+	/**
+	 * @brief Record filter application.
+	 * Can only be called in recording mode.
+	 * @param filter - filter application to record.
+	 */
+	void record_filter(filter_application filter);
+};
+
+/**
+ * @brief Save render_canvas matrix and restore it on scope exit.
+ */
+class canvas_matrix_push
+{
+	render_canvas& canvas;
+	render_canvas::matrix_type matrix;
+
+public:
+	canvas_matrix_push(render_canvas& canvas) :
+		canvas(canvas),
+		matrix(canvas.get_matrix())
+	{}
+
+	canvas_matrix_push(const canvas_matrix_push&) = delete;
+	canvas_matrix_push& operator=(const canvas_matrix_push&) = delete;
+
+	canvas_matrix_push(canvas_matrix_push&&) = delete;
+	canvas_matrix_push& operator=(canvas_matrix_push&&) = delete;
+
+	~canvas_matrix_push() noexcept
+	{
+		this->canvas.set_matrix(this->matrix);
+	}
+};
+
+} // namespace svgren
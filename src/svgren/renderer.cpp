@@ -27,6 +27,7 @@ SOFTWARE.
 
 #include "renderer.hxx"
 
+#include <algorithm>
 #include <ratio>
 
 #include <svgdom/elements/coordinate_units.hpp>
@@ -35,6 +36,8 @@ SOFTWARE.
 
 #include "config.hxx"
 #include "filter_applier.hxx"
+#include "limit_exceeded.hxx"
+#include "parallel.hxx"
 #include "util.hxx"
 
 using namespace svgren;
@@ -207,7 +210,7 @@ void renderer::apply_viewbox(const svgdom::view_boxed& e, const svgdom::aspect_r
 }
 
 void renderer::set_gradient_properties(
-	veg::gradient& gradient, //
+	gradient_paint& gradient, //
 	const svgdom::gradient& g,
 	const svgdom::style_stack& ss
 )
@@ -283,8 +286,8 @@ void renderer::set_gradient_properties(
 		stop->accept(visitor);
 	}
 
-	gradient.set_stops(utki::make_span(visitor.stops));
-	gradient.set_spread_method(to_veg_gradient_spread_method(this->gradient_get_spread_method(g)));
+	gradient.stops = std::move(visitor.stops);
+	gradient.spread_method = to_veg_gradient_spread_method(this->gradient_get_spread_method(g));
 }
 
 void renderer::apply_filter()
@@ -303,10 +306,34 @@ void renderer::apply_filter(const std::string& id)
 		return;
 	}
 
+	if (this->canvas.is_recording()) {
+		// filters need pixels of the rendered image, so only record the filter application
+		this->canvas.record_filter({
+			id, //
+			this->user_space_bounding_box,
+			this->device_space_bounding_box,
+			this->viewport
+		});
+		return;
+	}
+
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::filter_time);
+
 	filter_applier visitor(*this);
 
 	ASSERT(e)
-	e->accept(visitor);
+	try {
+		e->accept(visitor);
+	} catch (limit_exceeded&) {
+		// Applying the filter would exceed the limits, skip the filtered element.
+		// Element with filter is always rendered to a separate group, so clear the group.
+		for (auto line : this->canvas.get_image_span()) {
+			std::fill(line.begin(), line.end(), image_type::pixel_type(0));
+		}
+		return;
+	}
+
+	this->filter_reach += visitor.get_reach();
 
 	this->blit(visitor.get_last_result());
 }
@@ -323,7 +350,7 @@ void renderer::set_gradient(const std::string& id)
 	ASSERT(e)
 
 	struct common_gradient_push {
-		veg::canvas_matrix_push matrix_push;
+		canvas_matrix_push matrix_push;
 
 		std::unique_ptr<renderer_viewport_push> viewport_push;
 
@@ -371,12 +398,11 @@ void renderer::set_gradient(const std::string& id)
 		{
 			common_gradient_push common_push(this->r, gradient);
 
-			auto g = std::make_shared<veg::linear_gradient>(
-				this->r.length_to_px(this->r.gradient_get_x1(gradient), this->r.gradient_get_y1(gradient)),
-				this->r.length_to_px(this->r.gradient_get_x2(gradient), this->r.gradient_get_y2(gradient))
-			);
+			gradient_paint g;
+			g.p1 = this->r.length_to_px(this->r.gradient_get_x1(gradient), this->r.gradient_get_y1(gradient));
+			g.p2 = this->r.length_to_px(this->r.gradient_get_x2(gradient), this->r.gradient_get_y2(gradient));
 
-			this->r.set_gradient_properties(*g, gradient, this->ss);
+			this->r.set_gradient_properties(g, gradient, this->ss);
 
 			this->r.canvas.set_source(g);
 		}
@@ -398,13 +424,13 @@ void renderer::set_gradient(const std::string& id)
 				fy = cy;
 			}
 
-			auto g = std::make_shared<veg::radial_gradient>(
-				this->r.length_to_px(fx, fy),
-				this->r.length_to_px(cx, cy),
-				this->r.length_to_px(radius)
-			);
+			gradient_paint g;
+			g.is_radial = true;
+			g.p1 = this->r.length_to_px(fx, fy);
+			g.p2 = this->r.length_to_px(cx, cy);
+			g.radius = this->r.length_to_px(radius);
 
-			this->r.set_gradient_properties(*g, gradient, this->ss);
+			this->r.set_gradient_properties(g, gradient, this->ss);
 
 			this->r.canvas.set_source(g);
 		}
@@ -493,6 +519,8 @@ veg::line_join to_veg_line_join(svgdom::stroke_line_join lj)
 
 void renderer::render_shape(bool is_group_pushed)
 {
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::style_time);
+
 	this->update_bounding_box();
 
 	{
@@ -665,13 +693,29 @@ void renderer::render_svg_element(
 	this->apply_filter();
 }
 
-renderer::renderer(veg::canvas& canvas, unsigned dpi, r4::vector2<real> viewport, const svgdom::svg_element& root) :
+renderer::renderer(
+	veg::canvas& canvas, //
+	r4::vector2<real> viewport,
+	const prepared_document& doc,
+	const parameters& params
+) :
 	canvas(canvas),
-	finder_by_id(root),
-	style_stack_cache(root),
-	dpi(real(dpi)),
+	finder_by_id(doc.finder_by_id),
+	style_stack_cache(doc.style_stack_cache),
+	dpi(real(params.dpi)),
+	cancellation(params),
+	limits(params.limits),
+	blur(params.blur),
+	blur_downscaling(params.blur_downscaling),
+	filter_result_release(params.filter_result_release),
+	num_filter_threads(get_num_threads(params.num_filter_threads)),
+	stats(params.stats ? std::make_unique<stats_collector>() : nullptr),
 	viewport(viewport)
 {
+	if (this->stats) {
+		this->canvas.collect_stats(*this->stats);
+	}
+
 	this->device_space_bounding_box.set_empty_bounding_box();
 	this->background = surface(this->canvas.get_image_span());
 
@@ -692,6 +736,18 @@ renderer::renderer(veg::canvas& canvas, unsigned dpi, r4::vector2<real> viewport
 #endif
 }
 
+void renderer::relay_accept(const svgdom::container& e)
+{
+	for (const auto& c : e.children) {
+		try {
+			c->accept(*this);
+			// NOLINTNEXTLINE(bugprone-empty-catch)
+		} catch (limit_exceeded&) {
+			// rendering the child would exceed the limits, skip it
+		}
+	}
+}
+
 void renderer::visit(const svgdom::g_element& e)
 {
 	//	TRACE(<< "rendering GElement: id = " << e.id << std::endl)
@@ -718,6 +774,15 @@ void renderer::visit(const svgdom::use_element& e)
 		return;
 	}
 
+	if (this->use_depth >= this->limits.max_use_depth) {
+		return;
+	}
+
+	++this->use_depth;
+	utki::scope_exit use_depth_scope_exit([this]() {
+		--this->use_depth;
+	});
+
 	struct ref_renderer : public svgdom::const_visitor {
 		renderer& r;
 		const svgdom::use_element& ue;
@@ -911,6 +976,8 @@ void renderer::visit(const svgdom::path_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	r4::vector2<real> prev_quadratic_p = 0;
@@ -1147,6 +1214,8 @@ void renderer::visit(const svgdom::circle_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	auto c = this->length_to_px(e.cx, e.cy);
@@ -1168,6 +1237,8 @@ void renderer::visit(const svgdom::polyline_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	if (e.points.empty()) {
@@ -1196,6 +1267,8 @@ void renderer::visit(const svgdom::polygon_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	if (e.points.size() == 0) {
@@ -1226,6 +1299,8 @@ void renderer::visit(const svgdom::line_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	this->canvas.move_abs(this->length_to_px(e.x1, e.y1));
@@ -1245,6 +1320,8 @@ void renderer::visit(const svgdom::ellipse_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	auto c = this->length_to_px(e.cx, e.cy);
@@ -1294,6 +1371,8 @@ void renderer::visit(const svgdom::rect_element& e)
 
 	common_element_push group_push(*this, false);
 
+	stats_stage_scope stage_scope(this->stats.get(), &rasterization_stats::geometry_time);
+
 	this->apply_transformations(e.transformations);
 
 	auto dims = this->length_to_px(e.width, e.height);
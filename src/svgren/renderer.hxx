@@ -27,6 +27,7 @@ SOFTWARE.
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <svgdom/elements/aspect_ratioed.hpp>
@@ -37,7 +38,12 @@ SOFTWARE.
 #include <utki/config.hpp>
 #include <veg/canvas.hpp>
 
+#include "cancellation_token.hxx"
+#include "command_buffer.hxx"
 #include "config.hxx"
+#include "prepared_document.hpp"
+#include "render_canvas.hxx"
+#include "stats.hxx"
 #include "surface.hxx"
 #include "util.hxx"
 
@@ -46,13 +52,34 @@ namespace svgren {
 class renderer : public svgdom::const_visitor
 {
 public:
-	veg::canvas& canvas;
+	render_canvas canvas;
 
-	svgdom::finder_by_id finder_by_id;
-	svgdom::style_stack_cache style_stack_cache;
+	const svgdom::finder_by_id& finder_by_id;
+	const svgdom::style_stack_cache& style_stack_cache;
 
 	const real dpi;
 
+	const cancellation_token cancellation;
+
+	const rasterization_limits limits;
+
+	const blur_algorithm blur;
+	const bool blur_downscaling;
+
+	// release filter primitive results which are not used anymore
+	const bool filter_result_release;
+
+	// number of threads for filter effect kernels
+	const unsigned num_filter_threads;
+
+	// counters to check against the limits
+	unsigned num_element_visits = 0;
+	unsigned group_depth = 0;
+	unsigned use_depth = 0;
+
+	// statistics collector, nullptr if statistics are not requested
+	const std::unique_ptr<stats_collector> stats;
+
 	bool is_outermost_element = true;
 
 	r4::vector2<real> viewport;
@@ -67,6 +94,10 @@ public:
 
 	surface background; // for accessing background image from filter effects
 
+	// Maximum reach of filter effects applied within the currently rendered element.
+	// Reaches of nested filters add up.
+	r4::vector2<unsigned> filter_reach = 0;
+
 	void blit(const surface& s);
 
 	real length_to_px(const svgdom::length& l) const noexcept;
@@ -77,7 +108,7 @@ public:
 	void apply_transformations(const decltype(svgdom::transformable::transformations)& transformations);
 
 	void set_gradient_properties(
-		veg::gradient& gradient, //
+		gradient_paint& gradient, //
 		const svgdom::gradient& g,
 		const svgdom::style_stack& ss
 	);
@@ -132,16 +163,13 @@ public:
 public:
 	renderer(
 		veg::canvas& canvas, //
-		unsigned dpi,
 		r4::vector2<real> viewport,
-		const svgdom::svg_element& root
+		const prepared_document& doc,
+		const parameters& params
 	);
 
-	// declare public method which calls protected one.
-	void relay_accept(const svgdom::container& e)
-	{
-		this->const_visitor::relay_accept(e);
-	}
+	// Visit children of the container. Children exceeding rasterization limits are skipped.
+	void relay_accept(const svgdom::container& e);
 
 	void visit(const svgdom::g_element& e) override;
 	void visit(const svgdom::use_element& e) override;
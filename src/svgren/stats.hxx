@@ -0,0 +1,110 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2015-2026 Ivan Gagis <igagis@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+/* ================ LICENSE END ================ */
+
+#pragma once
+
+#include <chrono>
+
+#include "render.hpp"
+
+namespace svgren {
+
+/**
+ * @brief Collector of rasterization statistics.
+ * Besides counters, it accounts time to rasterization stages. At each moment at most one stage
+ * is active, so stage times are exclusive.
+ */
+class stats_collector
+{
+public:
+	using stage_type = std::chrono::nanoseconds rasterization_stats::*;
+
+	rasterization_stats stats;
+
+private:
+	stage_type stage = nullptr;
+	std::chrono::steady_clock::time_point stage_start;
+
+public:
+	/**
+	 * @brief Switch to another stage.
+	 * Time passed since previous switch is accounted to the current stage.
+	 * @param new_stage - stage to switch to, nullptr means no stage.
+	 * @return Previously active stage.
+	 */
+	stage_type switch_stage(stage_type new_stage)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (this->stage) {
+			this->stats.*(this->stage) += now - this->stage_start;
+		}
+		this->stage_start = now;
+
+		auto ret = this->stage;
+		this->stage = new_stage;
+		return ret;
+	}
+};
+
+/**
+ * @brief Activate rasterization stage for the scope.
+ * Previously active stage is restored on scope exit.
+ */
+class stats_stage_scope
+{
+	stats_collector* collector;
+	stats_collector::stage_type previous_stage = nullptr;
+
+public:
+	/**
+	 * @brief Constructor.
+	 * @param collector - statistics collector, can be nullptr in which case nothing is done.
+	 * @param stage - stage to activate.
+	 */
+	stats_stage_scope(stats_collector* collector, stats_collector::stage_type stage) :
+		collector(collector)
+	{
+		if (this->collector) {
+			this->previous_stage = this->collector->switch_stage(stage);
+		}
+	}
+
+	stats_stage_scope(const stats_stage_scope&) = delete;
+	stats_stage_scope& operator=(const stats_stage_scope&) = delete;
+
+	stats_stage_scope(stats_stage_scope&&) = delete;
+	stats_stage_scope& operator=(stats_stage_scope&&) = delete;
+
+	~stats_stage_scope() noexcept
+	{
+		if (this->collector) {
+			this->collector->switch_stage(this->previous_stage);
+		}
+	}
+};
+
+} // namespace svgren
@@ -36,6 +36,7 @@ SOFTWARE.
 #include <utki/debug.hpp>
 #include <utki/math.hpp>
 
+#include "limit_exceeded.hxx"
 #include "renderer.hxx"
 
 using namespace svgren;
@@ -66,10 +67,20 @@ renderer_viewport_push::~renderer_viewport_push() noexcept
 common_element_push::common_element_push(svgren::renderer& renderer, bool is_container) :
 	renderer(renderer),
 	matrix_push(this->renderer.canvas),
-	old_device_space_bounding_box(renderer.device_space_bounding_box)
+	old_device_space_bounding_box(renderer.device_space_bounding_box),
+	old_filter_reach(renderer.filter_reach)
 {
-	// old device space bounding box is saved, set current one to empty
-	this->renderer.device_space_bounding_box.set_empty_bounding_box();
+	this->renderer.cancellation.check();
+
+	if (this->renderer.num_element_visits == this->renderer.limits.max_element_visits) {
+		throw limit_exceeded("element visits limit exceeded");
+	}
+	++this->renderer.num_element_visits;
+
+	stats_stage_scope stage_scope(this->renderer.stats.get(), &rasterization_stats::style_time);
+	if (this->renderer.stats) {
+		++this->renderer.stats->stats.num_elements;
+	}
 
 	auto background_prop = this->renderer.style_stack.get_style_property(svgdom::style_property::enable_background);
 
@@ -113,15 +124,30 @@ common_element_push::common_element_push(svgren::renderer& renderer, bool is_con
 		}
 	}
 
+	if (this->group_pushed && this->renderer.group_depth == this->renderer.limits.max_group_depth) {
+		throw limit_exceeded("group depth limit exceeded");
+	}
+
+	// NOTE: nothing should throw below this point, because renderer state is modified and
+	//       destructor restores it only for fully constructed object
+
+	// old device space bounding box is saved, set current one to empty
+	this->renderer.device_space_bounding_box.set_empty_bounding_box();
+
+	// old filter reach is saved, start accumulating filter reach of this element from zero
+	this->renderer.filter_reach.set(0);
+
 	if (this->group_pushed) {
 		//		TRACE(<< "setting temp context" << std::endl)
 		this->renderer.canvas.push_group();
+		++this->renderer.group_depth;
 
 		this->opacity = opacity;
 	}
 
 	if (!this->old_background.image_span.empty()) {
 		this->renderer.background = surface(this->renderer.canvas.get_image_span());
+		this->renderer.canvas.mark_background_push();
 	}
 }
 
@@ -131,11 +157,19 @@ common_element_push::~common_element_push() noexcept
 	this->old_device_space_bounding_box.unite(this->renderer.device_space_bounding_box);
 	this->renderer.device_space_bounding_box = this->old_device_space_bounding_box;
 
+	utki::scope_exit filter_reach_scope_exit([this]() {
+		// filters of sibling elements do not add up, so take maximum
+		using std::max;
+		this->renderer.filter_reach = max(this->old_filter_reach, this->renderer.filter_reach);
+	});
+
 	if (!this->group_pushed) {
 		return;
 	}
 
 	if (this->mask_element) {
+		stats_stage_scope stage_scope(this->renderer.stats.get(), &rasterization_stats::mask_time);
+
 		// render mask
 		try {
 			this->renderer.canvas.push_group();
@@ -181,5 +215,8 @@ common_element_push::~common_element_push() noexcept
 	// restore background if it was pushed
 	if (!this->old_background.image_span.empty()) {
 		this->renderer.background = this->old_background;
+		this->renderer.canvas.mark_background_pop();
 	}
+
+	--this->renderer.group_depth;
 }
@@ -40,6 +40,7 @@ SOFTWARE.
 #include "veg/util.hpp"
 
 #include "config.hxx"
+#include "render_canvas.hxx"
 #include "surface.hxx"
 
 namespace svgren {
@@ -73,10 +74,12 @@ class common_element_push
 
 	const svgdom::element* mask_element = nullptr;
 
-	veg::canvas_matrix_push matrix_push;
+	canvas_matrix_push matrix_push;
 
 	r4::segment2<real> old_device_space_bounding_box;
 
+	r4::vector2<unsigned> old_filter_reach;
+
 public:
 	common_element_push(svgren::renderer& renderer, bool is_container);
 
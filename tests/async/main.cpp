@@ -29,6 +29,30 @@ int main(int argc, const char** argv) {
 				}
 			);
 	}
+
+	// rasterize same prepared documents from several threads simultaneously
+	std::vector<std::unique_ptr<svgren::prepared_document>> docs;
+
+	for(auto& svg : svgs){
+		docs.push_back(std::make_unique<svgren::prepared_document>(*svg));
+	}
+
+	const unsigned num_threads_per_doc = 3;
+
+	for(auto& doc : docs){
+		for(unsigned i = 0; i != num_threads_per_doc; ++i){
+			decltype(doc.get()) d = doc.get();
+			threads.emplace_back(
+					[d, i](){
+						svgren::parameters p;
+						// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+						p.dims_request.x() = 50 * (i + 1);
+						auto res = svgren::rasterize(*d, p);
+						utki::log([&](auto&o){o << "rendered prepared, width = " << res.dims().x() << std::endl;});
+					}
+				);
+		}
+	}
 	
 	for(auto& t : threads){
 		t.join();
@@ -0,0 +1,564 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string_view>
+
+#include <utki/debug.hpp>
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+// internal header, used for microbenchmarks of filter kernels
+#include "../../src/svgren/box_blur.hxx"
+#include "../../src/svgren/channel_luts.hxx"
+#include "../../src/svgren/color_matrix.hxx"
+#include "../../src/svgren/pixel_ops.hxx"
+#include "../../src/svgren/recursive_blur.hxx"
+
+// Heap memory accounting. Global operator new and delete are replaced to know current and peak
+// amount of allocated heap memory, this is used to measure peak memory of rasterization.
+namespace{
+std::atomic<size_t> current_memory = 0;
+std::atomic<size_t> peak_memory = 0;
+
+// allocation size is stored in front of each allocated block
+constexpr size_t header_size = alignof(std::max_align_t);
+
+void add_memory(size_t size){
+	size_t cur = current_memory += size;
+	size_t peak = peak_memory.load();
+	while(cur > peak && !peak_memory.compare_exchange_weak(peak, cur)){}
+}
+}
+
+void* operator new(size_t size){
+	void* p = std::malloc(size + header_size); // NOLINT(cppcoreguidelines-no-malloc)
+	if(!p){
+		throw std::bad_alloc();
+	}
+	*static_cast<size_t*>(p) = size;
+
+	add_memory(size);
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	return static_cast<char*>(p) + header_size;
+}
+
+void operator delete(void* p)noexcept{
+	if(!p){
+		return;
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto block = static_cast<char*>(p) - header_size;
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	current_memory -= *reinterpret_cast<size_t*>(block);
+	std::free(block); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void* p, size_t size)noexcept{
+	operator delete(p);
+}
+
+// Over-aligned allocations. The allocation size and the pointer returned by malloc()
+// are stored right in front of the aligned block.
+namespace{
+struct aligned_header{
+	size_t size;
+	void* block;
+};
+}
+
+void* operator new(size_t size, std::align_val_t alignment){
+	auto align = size_t(alignment);
+
+	void* p = std::malloc(size + sizeof(aligned_header) + align); // NOLINT(cppcoreguidelines-no-malloc)
+	if(!p){
+		throw std::bad_alloc();
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+	auto addr = reinterpret_cast<std::uintptr_t>(p) + sizeof(aligned_header);
+	addr = (addr + align - 1) & ~(std::uintptr_t(align) - 1);
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+	auto ret = reinterpret_cast<void*>(addr);
+
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto header = static_cast<aligned_header*>(ret) - 1;
+	header->size = size;
+	header->block = p;
+
+	add_memory(size);
+
+	return ret;
+}
+
+void operator delete(void* p, std::align_val_t alignment)noexcept{
+	if(!p){
+		return;
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+	auto header = static_cast<aligned_header*>(p) - 1;
+	current_memory -= header->size;
+	std::free(header->block); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void operator delete(void* p, size_t size, std::align_val_t alignment)noexcept{
+	operator delete(p, alignment);
+}
+
+namespace{
+struct config{
+	std::string samples_dir = "samples_data";
+
+	// 0 means native size of the SVG
+	std::vector<unsigned> widths = {0, 64, 256, 1024};
+
+	unsigned warmup = 2;
+	unsigned repetitions = 10;
+
+	std::string out_file;
+	std::string baseline_file;
+	std::string save_baseline_file;
+
+	// median time increase in percent which is considered a regression
+	double threshold = 10;
+
+	// run microbenchmarks of filter kernels instead of rasterizing the samples
+	bool kernels = false;
+};
+}
+
+namespace{
+struct measurement{
+	std::string file;
+	r4::vector2<unsigned> dims;
+	double median_ms = 0;
+	double p95_ms = 0;
+	size_t peak_memory_bytes = 0;
+	double pixels_per_second = 0;
+};
+}
+
+namespace{
+// get percentile of sorted values using nearest rank method
+double percentile(const std::vector<double>& sorted_values, unsigned percent){
+	ASSERT(!sorted_values.empty())
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	auto rank = (sorted_values.size() * percent + 99) / 100;
+	using std::max;
+	return sorted_values[max(rank, size_t(1)) - 1];
+}
+}
+
+namespace{
+measurement measure(const config& cfg, const std::string& name, r4::vector2<unsigned> dims, const std::function<void()>& run){
+	measurement ret;
+	ret.file = name;
+	ret.dims = dims;
+
+	for(unsigned i = 0; i != cfg.warmup; ++i){
+		run();
+	}
+
+	std::vector<double> times;
+	times.reserve(cfg.repetitions);
+
+	size_t memory_before = current_memory.load();
+	peak_memory = memory_before;
+
+	for(unsigned i = 0; i != cfg.repetitions; ++i){
+		auto start = std::chrono::steady_clock::now();
+		run();
+		auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	ret.peak_memory_bytes = peak_memory.load() - memory_before;
+
+	std::sort(times.begin(), times.end());
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	ret.median_ms = percentile(times, 50);
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	ret.p95_ms = percentile(times, 95);
+
+	if(ret.median_ms > 0){
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret.pixels_per_second = double(ret.dims.x()) * double(ret.dims.y()) * 1000 / ret.median_ms;
+	}
+
+	return ret;
+}
+}
+
+namespace{
+std::vector<measurement> measure_samples(const config& cfg){
+	std::vector<std::string> files;
+	{
+		const std::regex suffix_regex("^.*\\.svg$");
+		auto all_files = fsif::native_file(cfg.samples_dir).list_dir();
+
+		std::copy_if(
+				all_files.begin(),
+				all_files.end(),
+				std::back_inserter(files),
+				[&suffix_regex](auto& f){
+					return std::regex_match(f, suffix_regex);
+				}
+			);
+		std::sort(files.begin(), files.end());
+	}
+
+	std::vector<measurement> results;
+
+	for(const auto& f : files){
+		auto dom = svgdom::load(fsif::native_file(cfg.samples_dir + f));
+		svgren::prepared_document doc(*dom);
+
+		for(auto w : cfg.widths){
+			svgren::parameters params;
+			params.dims_request.x() = w;
+
+			auto dims = svgren::get_raster_dims(doc.svg, params);
+			if(!dims.is_positive()){
+				continue;
+			}
+
+			results.push_back(measure(cfg, f, dims, [&](){
+				svgren::rasterize(doc, params);
+			}));
+		}
+	}
+
+	return results;
+}
+}
+
+namespace{
+// Microbenchmarks of filter kernels on a 4K wide image.
+// Horizontal and vertical box blur passes are expected to run at about the same speed.
+// Recursive blur is a complete blur along both axes, while box blur results are for a single pass.
+// Color matrix result is for a general matrix, which is the slowest case.
+// Morphology is a complete dilate along both axes, its time does not depend on the radius.
+// Blend and composite combine the source with a translucent image, pixel by pixel.
+std::vector<measurement> measure_kernels(const config& cfg){
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	const r4::vector2<unsigned> dims = {3840, 2160};
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	const unsigned box_size = 31;
+
+	svgren::image_type src(dims);
+	svgren::image_type dst(dims);
+
+	// fill source with some pattern, so that the blur has something to do
+	for(unsigned y = 0; y != dims.y(); ++y){
+		for(unsigned x = 0; x != dims.x(); ++x){
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			src.span()[y][x] = {uint8_t(x), uint8_t(y), uint8_t(x ^ y), 0xff};
+		}
+	}
+
+	const svgren::cancellation_token cancellation;
+
+	std::vector<measurement> results;
+
+	results.push_back(measure(cfg, "box_blur_horizontal", dims, [&](){
+		svgren::box_blur_horizontal(dst.span(), src.span(), box_size, box_size / 2, cancellation);
+	}));
+	results.push_back(measure(cfg, "box_blur_vertical", dims, [&](){
+		svgren::box_blur_vertical(dst.span(), src.span(), box_size, box_size / 2, cancellation);
+	}));
+	results.push_back(measure(cfg, "recursive_blur", dims, [&](){
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		svgren::recursive_blur(dst.span(), src.span(), {16, 16}, 1, cancellation);
+	}));
+	{
+		// mix of colors, this is a general matrix, like saturate or hueRotate ones
+		// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+		const svgren::color_matrix_kernel kernel(
+			{
+				{ 0.5, 0.25, 0.25, 0},
+				{0.25,  0.5, 0.25, 0},
+				{0.25, 0.25,  0.5, 0},
+				{   0,    0,    0, 1}
+			},
+			{0, 0, 0, 0}
+		);
+		// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+		results.push_back(measure(cfg, "color_matrix", dims, [&](){
+			for(unsigned y = 0; y != dims.y(); ++y){
+				kernel.apply(dst.span()[y], src.span()[y]);
+			}
+		}));
+	}
+	{
+		// gamma correction of color channels, alpha is left as is
+		svgren::channel_luts luts;
+		for(unsigned i = 0; i != 4; ++i){
+			luts.set(i, [i](unsigned v){
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				auto c = float(v) / 0xff;
+				return i == 3 ? c : std::sqrt(c);
+			});
+		}
+		results.push_back(measure(cfg, "channel_luts", dims, [&](){
+			for(unsigned y = 0; y != dims.y(); ++y){
+				luts.apply(dst.span()[y], src.span()[y]);
+			}
+		}));
+	}
+	{
+		// second input of blend and composite, premultiplied pixels of varying opacity
+		svgren::image_type src2(dims);
+		for(unsigned y = 0; y != dims.y(); ++y){
+			for(unsigned x = 0; x != dims.x(); ++x){
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				auto a = uint8_t(x + y);
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				src2.span()[y][x] = {uint8_t(a / 2), uint8_t(a / 3), a, a};
+			}
+		}
+
+		auto combine = [&](const auto& op){
+			for(unsigned y = 0; y != dims.y(); ++y){
+				auto d = dst.span()[y].begin();
+				auto b = src2.span()[y].begin();
+				for(const auto& a : src.span()[y]){
+					*d = op(a, *b);
+					++d;
+					++b;
+				}
+			}
+		};
+
+		results.push_back(measure(cfg, "blend_multiply", dims, [&](){
+			combine(svgren::blend_op<svgdom::fe_blend_element::mode::multiply>());
+		}));
+		results.push_back(measure(cfg, "composite_atop", dims, [&](){
+			combine(svgren::composite_op<svgdom::fe_composite_element::operator_type::atop>());
+		}));
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		const svgren::composite_arithmetic_op arithmetic(0.5, 0.25, 0.25, 0);
+		results.push_back(measure(cfg, "composite_arithmetic", dims, [&](){
+			combine(arithmetic);
+		}));
+	}
+
+	return results;
+}
+}
+
+namespace{
+std::string escape_json(std::string_view str){
+	std::stringstream ss;
+	for(char c : str){
+		switch(c){
+			case '"':
+				ss << "\\\"";
+				break;
+			case '\\':
+				ss << "\\\\";
+				break;
+			case '\n':
+				ss << "\\n";
+				break;
+			case '\t':
+				ss << "\\t";
+				break;
+			case '\r':
+				ss << "\\r";
+				break;
+			default:
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				if(static_cast<unsigned char>(c) < 0x20){
+					ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << unsigned(c) << std::dec;
+				}else{
+					ss << c;
+				}
+				break;
+		}
+	}
+	return ss.str();
+}
+}
+
+namespace{
+std::string to_json(const std::vector<measurement>& results){
+	std::stringstream ss;
+	ss << "{\n\t\"results\": [\n";
+	for(auto i = results.begin(); i != results.end(); ++i){
+		ss << "\t\t{"
+				<< "\"file\": \"" << escape_json(i->file) << "\", "
+				<< "\"width\": " << i->dims.x() << ", "
+				<< "\"height\": " << i->dims.y() << ", "
+				<< "\"median_ms\": " << i->median_ms << ", "
+				<< "\"p95_ms\": " << i->p95_ms << ", "
+				<< "\"peak_memory_bytes\": " << i->peak_memory_bytes << ", "
+				<< "\"pixels_per_second\": " << i->pixels_per_second
+				<< "}" << (std::next(i) == results.end() ? "" : ",") << "\n";
+	}
+	ss << "\t]\n}\n";
+	return ss.str();
+}
+}
+
+namespace{
+// Baseline file has a line per measurement: width, height, median time in milliseconds and file name,
+// separated by spaces. The file name is the last, so it can contain spaces.
+void write_baseline(const std::string& file_name, const std::vector<measurement>& results){
+	std::ofstream f(file_name);
+	if(!f){
+		throw std::runtime_error("could not open baseline file: " + file_name);
+	}
+
+	for(const auto& m : results){
+		f << m.dims.x() << " " << m.dims.y() << " " << m.median_ms << " " << m.file << "\n";
+	}
+}
+}
+
+namespace{
+// read median times from baseline file previously written by this benchmark
+std::map<std::string, double> read_baseline(const std::string& file_name){
+	std::ifstream f(file_name);
+	if(!f){
+		throw std::runtime_error("could not open baseline file: " + file_name);
+	}
+
+	std::map<std::string, double> ret;
+
+	unsigned width = 0;
+	unsigned height = 0;
+	double median_ms = 0;
+	for(std::string file; f >> width >> height >> median_ms && std::getline(f >> std::ws, file);){
+		std::stringstream key;
+		key << file << " " << width << "x" << height;
+		ret[key.str()] = median_ms;
+	}
+
+	return ret;
+}
+}
+
+namespace{
+config parse_args(utki::span<const char*> args){
+	config cfg;
+
+	for(auto i = args.begin(); i != args.end(); ++i){
+		std::string_view arg = *i;
+
+		auto next = [&](){
+			++i;
+			if(i == args.end()){
+				throw std::invalid_argument("value expected after " + std::string(arg));
+			}
+			return std::string(*i);
+		};
+
+		if(arg == "--samples-dir"){
+			cfg.samples_dir = next();
+		}else if(arg == "--widths"){
+			cfg.widths.clear();
+			std::stringstream ss(next());
+			for(std::string w; std::getline(ss, w, ',');){
+				cfg.widths.push_back(unsigned(std::stoul(w)));
+			}
+		}else if(arg == "--warmup"){
+			cfg.warmup = unsigned(std::stoul(next()));
+		}else if(arg == "--repetitions"){
+			cfg.repetitions = unsigned(std::stoul(next()));
+		}else if(arg == "--out"){
+			cfg.out_file = next();
+		}else if(arg == "--baseline"){
+			cfg.baseline_file = next();
+		}else if(arg == "--save-baseline"){
+			cfg.save_baseline_file = next();
+		}else if(arg == "--threshold"){
+			cfg.threshold = std::stod(next());
+		}else if(arg == "--kernels"){
+			cfg.kernels = true;
+		}else{
+			throw std::invalid_argument("unknown argument: " + std::string(arg));
+		}
+	}
+
+	if(cfg.repetitions == 0){
+		throw std::invalid_argument("number of repetitions must be greater than 0");
+	}
+
+	if(!cfg.samples_dir.empty() && cfg.samples_dir.back() != '/'){
+		cfg.samples_dir.push_back('/');
+	}
+
+	return cfg;
+}
+}
+
+// NOLINTNEXTLINE(bugprone-exception-escape, "we need exceptions from main() to indicate failure")
+int main(int argc, const char** argv){
+	auto cfg = parse_args(utki::make_span(std::next(argv), argc - 1));
+
+	auto results = cfg.kernels ? measure_kernels(cfg) : measure_samples(cfg);
+
+	for(const auto& m : results){
+		std::cerr << m.file << " " << m.dims << ": median = " << m.median_ms << " ms, p95 = " << m.p95_ms << " ms" << std::endl;
+	}
+
+	auto json = to_json(results);
+
+	if(cfg.out_file.empty()){
+		std::cout << json;
+	}else{
+		std::ofstream(cfg.out_file) << json;
+	}
+
+	if(!cfg.save_baseline_file.empty()){
+		write_baseline(cfg.save_baseline_file, results);
+	}
+
+	if(cfg.baseline_file.empty()){
+		return 0;
+	}
+
+	auto baseline = read_baseline(cfg.baseline_file);
+
+	unsigned num_regressions = 0;
+
+	for(const auto& m : results){
+		std::stringstream key;
+		key << m.file << " " << m.dims.x() << "x" << m.dims.y();
+
+		auto i = baseline.find(key.str());
+		if(i == baseline.end()){
+			continue;
+		}
+
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		if(m.median_ms > i->second * (1 + cfg.threshold / 100)){
+			++num_regressions;
+			std::cerr << "REGRESSION: " << key.str() << ": median = " << m.median_ms << " ms, baseline = " << i->second << " ms" << std::endl;
+		}
+	}
+
+	if(num_regressions != 0){
+		std::cerr << num_regressions << " regression(s) found" << std::endl;
+		return 1;
+	}
+
+	std::cerr << "no regressions found" << std::endl;
+	return 0;
+}
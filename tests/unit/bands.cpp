@@ -0,0 +1,69 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+#include "util.hxx"
+
+namespace{
+// Shapes are rasterized at different offsets within the band canvases, which can change
+// antialiasing coverage by rounding, but filter output must not leak out of the filter region.
+const unsigned tolerance = 2;
+
+const std::string data_dir = "samples_data/";
+}
+
+namespace{
+const tst::set set("bands", [](tst::suite& suite){
+	auto files = list_svg_files(data_dir);
+
+	suite.add<std::string>(
+		"band_rasterization_matches_whole_image",
+		files,
+		[](const auto& p){
+			auto dom = svgdom::load(fsif::native_file(data_dir + p));
+
+			svgren::prepared_document doc(*dom);
+
+			// Downscaled blur blocks are aligned to the filter region start, and the automatic blur
+			// algorithm choice depends on the region size, both of which differ between the bands.
+			svgren::parameters params;
+			params.blur = svgren::blur_algorithm::box;
+			params.blur_downscaling = false;
+
+			auto expected = svgren::rasterize(doc, params);
+
+			tst::check_eq(svgren::get_raster_dims(*dom), expected.dims(), SL);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			const unsigned band_height = 17;
+
+			unsigned next_y = 0;
+
+			svgren::rasterize_bands(
+					doc,
+					band_height,
+					[&](auto band, unsigned y){
+						tst::check_eq(y, next_y, SL) << "bands are not in order, file = " << p;
+						tst::check_eq(band.dims().x(), expected.dims().x(), SL);
+						tst::check(band.dims().y() <= band_height, SL);
+
+						next_y = y + band.dims().y();
+
+						check_close(
+								expected.span().subspan({{0, y}, band.dims()}),
+								band,
+								tolerance,
+								p
+							);
+					},
+					params
+				);
+
+			tst::check_eq(next_y, expected.dims().y(), SL) << "not all bands rendered, file = " << p;
+		}
+	);
+});
+}
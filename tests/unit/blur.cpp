@@ -0,0 +1,121 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cmath>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/recursive_blur.hxx"
+#include "../../src/svgren/render.hpp"
+
+#include "util.hxx"
+
+namespace{
+// box blur and recursive blur are different approximations of Gaussian blur,
+// so results differ a bit more than usual
+const unsigned tolerance = 16;
+
+// maximum difference of blurring at reduced resolution, see svgren::parameters::blur_downscaling
+const unsigned downscaling_tolerance = 8;
+}
+
+namespace{
+const tst::set set("blur", [](tst::suite& suite){
+	suite.add<std::string>(
+		"recursive_blur_is_close_to_box_blur",
+		{
+			"samples_data/car.svg",
+			"samples_data/gauge_arrow_shadow.svg"
+		},
+		[](const auto& p){
+			auto dom = svgdom::load(fsif::native_file(p));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::parameters params;
+			// large image, so that device space standard deviations are large
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.dims_request.x() = 1024;
+
+			// blur at full resolution as well as at reduced resolution
+			for(bool downscaling : {false, true}){
+				params.blur_downscaling = downscaling;
+
+				params.blur = svgren::blur_algorithm::box;
+				auto box = svgren::rasterize(*dom, params);
+
+				params.blur = svgren::blur_algorithm::recursive;
+				auto recursive = svgren::rasterize(*dom, params);
+
+				check_close(box, recursive, tolerance, p);
+			}
+		}
+	);
+
+	suite.add<unsigned>(
+		"downscaled_blur_is_close_to_full_resolution_blur",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{0, 1800},
+		[](const auto& width){
+			// the document has blurs with large standard deviation
+			const std::string file = "samples_data/car.svg";
+
+			auto dom = svgdom::load(fsif::native_file(file));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::parameters params;
+			params.dims_request.x() = width;
+			params.blur = svgren::blur_algorithm::box;
+
+			params.blur_downscaling = false;
+			auto full = svgren::rasterize(*dom, params);
+
+			params.blur_downscaling = true;
+			auto downscaled = svgren::rasterize(*dom, params);
+
+			check_close(full, downscaled, downscaling_tolerance, file);
+		}
+	);
+
+	suite.add<unsigned>(
+		"recursive_blur_of_edge_is_close_to_gaussian",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{2, 10, 50, 200, 500},
+		[](const auto& std_deviation){
+			// Opaque white half-plane, blurring it gives the Gaussian integral across the edge.
+			// The image is wide enough for the response to decay within it.
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			unsigned width = std_deviation * 16 + 1;
+			unsigned edge = width / 2;
+
+			svgren::image_type src({width, 3});
+			for(unsigned y = 0; y != src.dims().y(); ++y){
+				for(unsigned x = 0; x != width; ++x){
+					uint8_t v = x < edge ? 0 : 0xff;
+					src.span()[y][x] = {v, v, v, v};
+				}
+			}
+
+			svgren::image_type dst(src.dims());
+
+			const svgren::cancellation_token cancellation;
+
+			svgren::recursive_blur(dst.span(), src.span(), {svgren::real(std_deviation), 0}, 1, cancellation);
+
+			for(unsigned x = 0; x != width; ++x){
+				// pixel covers [x, x + 1) and the edge is at the left side of the edge pixel
+				auto d = (double(x) + 0.5 - double(edge)) / (double(std_deviation) * std::sqrt(2.0));
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				auto expected = 0xff * 0.5 * (1 + std::erf(d));
+
+				auto actual = dst.span()[1][x].a();
+
+				tst::check(std::abs(double(actual) - expected) <= 2, SL)
+						<< "x = " << x << ", expected = " << expected << ", actual = " << unsigned(actual)
+						<< ", std_deviation = " << std_deviation;
+			}
+		}
+	);
+});
+}
@@ -0,0 +1,209 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "../../src/svgren/box_blur.hxx"
+
+#include "util.hxx"
+
+namespace{
+svgren::box_blur_kernel to_kernel(const std::string& name){
+	if(name == "sse2"){
+		return svgren::box_blur_kernel::sse2;
+	}else if(name == "avx2"){
+		return svgren::box_blur_kernel::avx2;
+	}else if(name == "automatic"){
+		return svgren::box_blur_kernel::automatic;
+	}
+	return svgren::box_blur_kernel::generic;
+}
+
+const std::vector<std::string> kernel_names = {"generic", "sse2", "avx2", "automatic"};
+}
+
+namespace{
+// Straightforward box blur along rows, pixels outside of the image are taken from the image edge.
+// The sum is scaled the same way as in the kernels, see svgren::box_blur_horizontal().
+svgren::image_type box_blur_horizontal_reference(const svgren::image_type& src, unsigned box_size, unsigned box_offset){
+	const auto& dims = src.dims();
+
+	svgren::image_type ret(dims);
+
+	auto scale = 1.0f / float(box_size);
+
+	for(unsigned y = 0; y != dims.y(); ++y){
+		for(unsigned x = 0; x != dims.x(); ++x){
+			auto& px = ret.pixels()[size_t(y) * dims.x() + x];
+			for(unsigned c = 0; c != px.size(); ++c){
+				uint32_t sum = 0;
+				for(unsigned i = 0; i != box_size; ++i){
+					auto sx = std::clamp(int(x) - int(box_offset) + int(i), 0, int(dims.x()) - 1);
+					sum += src.pixels()[size_t(y) * dims.x() + unsigned(sx)][c];
+				}
+				px[c] = uint8_t(std::lrint(float(sum) * scale));
+			}
+		}
+	}
+
+	return ret;
+}
+}
+
+namespace{
+// Straightforward box blur along columns, see box_blur_horizontal_reference().
+svgren::image_type box_blur_vertical_reference(const svgren::image_type& src, unsigned box_size, unsigned box_offset){
+	const auto& dims = src.dims();
+
+	svgren::image_type ret(dims);
+
+	auto scale = 1.0f / float(box_size);
+
+	for(unsigned y = 0; y != dims.y(); ++y){
+		for(unsigned x = 0; x != dims.x(); ++x){
+			auto& px = ret.pixels()[size_t(y) * dims.x() + x];
+			for(unsigned c = 0; c != px.size(); ++c){
+				uint32_t sum = 0;
+				for(unsigned i = 0; i != box_size; ++i){
+					auto sy = std::clamp(int(y) - int(box_offset) + int(i), 0, int(dims.y()) - 1);
+					sum += src.pixels()[size_t(sy) * dims.x() + x][c];
+				}
+				px[c] = uint8_t(std::lrint(float(sum) * scale));
+			}
+		}
+	}
+
+	return ret;
+}
+}
+
+namespace{
+const tst::set set("box_blur", [](tst::suite& suite){
+	suite.add<std::string>(
+		"horizontal_kernel_matches_reference",
+		kernel_names,
+		[](const auto& p){
+			auto kernel = to_kernel(p);
+			if(!svgren::is_supported(kernel)){
+				// nothing to check on this CPU
+				return;
+			}
+
+			const svgren::cancellation_token cancellation;
+
+			unsigned seed = 0;
+
+			// Widths below and above the vector widths, odd heights leave a single line
+			// after the line pairs of the AVX2 kernel. Box sizes 1 and 2 are the smallest odd and even ones.
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			for(unsigned width : {1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 100}){
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				for(unsigned height : {1, 2, 3, 7}){
+					// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+					for(unsigned box_size : {1, 2, 3, 4, 9, 31, 200}){
+						for(unsigned box_offset : {0u, box_size / 2, box_size - 1}){
+							auto src = make_random_image({width, height}, ++seed);
+
+							svgren::image_type dst({width, height});
+
+							svgren::box_blur_horizontal(dst.span(), src.span(), box_size, box_offset, cancellation, kernel);
+
+							auto expected = box_blur_horizontal_reference(src, box_size, box_offset);
+
+							for(size_t i = 0; i != dst.pixels().size(); ++i){
+								tst::check(dst.pixels()[i] == expected.pixels()[i], SL)
+										<< "pixel #" << i << " differs, kernel = " << p
+										<< ", dims = " << width << "x" << height
+										<< ", box size = " << box_size << ", box offset = " << box_offset;
+							}
+						}
+					}
+				}
+			}
+		}
+	);
+
+	suite.add<std::string>(
+		"horizontal_kernel_works_on_image_subspan",
+		kernel_names,
+		[](const auto& p){
+			auto kernel = to_kernel(p);
+			if(!svgren::is_supported(kernel)){
+				return;
+			}
+
+			const svgren::cancellation_token cancellation;
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			auto src = make_random_image({40, 30}, 1);
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			svgren::image_type dst({40, 30});
+
+			// rows of the subspans are not contiguous in memory
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			const r4::rectangle<unsigned> rect = {{3, 5}, {21, 11}};
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			svgren::box_blur_horizontal(dst.span().subspan(rect), src.span().subspan(rect), 5, 2, cancellation, kernel);
+
+			svgren::image_type sub(rect.d);
+			sub.span().blit(src.span().subspan(rect), {0, 0});
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			auto expected = box_blur_horizontal_reference(sub, 5, 2);
+
+			for(unsigned y = 0; y != rect.d.y(); ++y){
+				for(unsigned x = 0; x != rect.d.x(); ++x){
+					tst::check(dst.span()[rect.p.y() + y][rect.p.x() + x] == expected.span()[y][x], SL)
+							<< "pixel (" << x << ", " << y << ") differs, kernel = " << p;
+				}
+			}
+		}
+	);
+
+	suite.add<std::string>(
+		"vertical_kernel_matches_reference",
+		kernel_names,
+		[](const auto& p){
+			auto kernel = to_kernel(p);
+			if(!svgren::is_supported(kernel)){
+				return;
+			}
+
+			const svgren::cancellation_token cancellation;
+
+			unsigned seed = 0;
+
+			// Columns are blurred in blocks of 1024 pixels, each block in chunks of 16 bytes (4 pixels)
+			// and the rest of the block by the generic code. Widths above 1024 give more than one block,
+			// widths not multiple of 4 leave a tail of columns after the chunks.
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			for(unsigned width : {1, 3, 4, 6, 17, 1024, 1025, 1031, 2050}){
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				for(unsigned height : {1, 2, 5, 13}){
+					// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+					for(unsigned box_size : {1, 2, 3, 8, 20}){
+						for(unsigned box_offset : {0u, box_size / 2, box_size - 1}){
+							auto src = make_random_image({width, height}, ++seed);
+
+							svgren::image_type dst({width, height});
+
+							svgren::box_blur_vertical(dst.span(), src.span(), box_size, box_offset, cancellation, kernel);
+
+							auto expected = box_blur_vertical_reference(src, box_size, box_offset);
+
+							for(size_t i = 0; i != dst.pixels().size(); ++i){
+								tst::check(dst.pixels()[i] == expected.pixels()[i], SL)
+										<< "pixel #" << i << " differs, kernel = " << p
+										<< ", dims = " << width << "x" << height
+										<< ", box size = " << box_size << ", box offset = " << box_offset;
+							}
+						}
+					}
+				}
+			}
+		}
+	);
+});
+}
@@ -0,0 +1,134 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <vector>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+namespace{
+const tst::set set("cancellation", [](tst::suite& suite){
+	suite.add<unsigned>(
+		"set_cancel_flag_aborts_rasterization",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{1, 4},
+		[](const auto& num_threads){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			std::atomic_bool cancel_flag = true;
+
+			svgren::parameters p;
+			p.num_threads = num_threads;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			p.tile_dims = decltype(p.tile_dims){16, 16};
+			p.cancel_flag = &cancel_flag;
+
+			bool thrown = false;
+			try{
+				svgren::rasterize(*dom, p);
+			}catch(svgren::deadline_exceeded&){
+				tst::check(false, SL) << "wrong exception thrown";
+			}catch(svgren::canceled&){
+				thrown = true;
+			}
+
+			tst::check(thrown, SL);
+		}
+	);
+
+	suite.add(
+		"passed_deadline_aborts_rasterization",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/dropshadowfilter.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::parameters p;
+			p.deadline = std::chrono::steady_clock::now();
+
+			bool thrown = false;
+			try{
+				svgren::rasterize(*dom, p);
+			}catch(svgren::deadline_exceeded&){
+				thrown = true;
+			}
+
+			tst::check(thrown, SL);
+		}
+	);
+
+	suite.add(
+		"set_cancel_flag_aborts_batch_rasterization",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			std::atomic_bool cancel_flag = true;
+
+			std::vector<svgren::parameters> params(2);
+			params[1].cancel_flag = &cancel_flag;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params[1].dims_request = decltype(params[1].dims_request){64, 0};
+
+			bool thrown = false;
+			try{
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				svgren::rasterize(*dom, utki::make_span(params), 2);
+			}catch(svgren::deadline_exceeded&){
+				tst::check(false, SL) << "wrong exception thrown";
+			}catch(svgren::canceled&){
+				thrown = true;
+			}
+
+			tst::check(thrown, SL);
+		}
+	);
+
+	suite.add(
+		"passed_deadline_aborts_batch_rasterization",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/dropshadowfilter.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			std::vector<svgren::parameters> params(2);
+			params[0].deadline = std::chrono::steady_clock::now();
+
+			bool thrown = false;
+			try{
+				svgren::rasterize(*dom, utki::make_span(params));
+			}catch(svgren::deadline_exceeded&){
+				thrown = true;
+			}
+
+			tst::check(thrown, SL);
+		}
+	);
+
+	suite.add(
+		"unset_cancel_flag_does_not_affect_rasterization",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			auto expected = svgren::rasterize(*dom);
+
+			std::atomic_bool cancel_flag = false;
+
+			svgren::parameters p;
+			p.cancel_flag = &cancel_flag;
+			p.deadline = std::chrono::steady_clock::now() + std::chrono::hours(1);
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), expected.dims(), SL);
+			tst::check(img.pixels() == expected.pixels(), SL);
+		}
+	);
+});
+}
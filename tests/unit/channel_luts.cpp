@@ -0,0 +1,187 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../src/svgren/channel_luts.hxx"
+
+#include "util.hxx"
+
+namespace{
+using channel_function = std::function<double(double)>;
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+
+// Functions of the shapes of feComponentTransfer ones. Slopes of the functions are not greater than 1,
+// so that rounding of unpremultiplied values changes the result by less than 1 of the premultiplied 8-bit value.
+const std::map<std::string, channel_function> functions = {
+	{
+		"identity",
+		[](double c){
+			return c;
+		}
+	},
+	{
+		// linear interpolation between the values
+		"table",
+		[](double c){
+			const std::array<double, 5> values = {0.1, 0.3, 0.55, 0.5, 0.3};
+			auto n = values.size() - 1;
+			auto k = std::min(size_t(std::floor(c * double(n))), n);
+			if(k == n){
+				return values[n];
+			}
+			return values[k] + (c * double(n) - double(k)) * (values[k + 1] - values[k]);
+		}
+	},
+	{
+		// steps of the values
+		"discrete",
+		[](double c){
+			const std::array<double, 3> values = {0.2, 0.9, 0.5};
+			return values[std::min(size_t(std::floor(c * double(values.size()))), values.size() - 1)];
+		}
+	},
+	{
+		// inverts the values, the result goes above 1 and is clamped
+		"linear",
+		[](double c){
+			return -0.9 * c + 1.05;
+		}
+	},
+	{
+		"gamma",
+		[](double c){
+			return 0.5 * c * c + 0.1;
+		}
+	}
+};
+
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+}
+
+namespace{
+svgren::channel_luts make_luts(const std::array<channel_function, 4>& funcs){
+	svgren::channel_luts ret;
+	for(unsigned i = 0; i != funcs.size(); ++i){
+		ret.set(i, [&](unsigned v){
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			return float(funcs[i](double(v) / 0xff));
+		});
+	}
+	return ret;
+}
+}
+
+namespace{
+// Unpremultiply, apply the functions, clamp and premultiply, all in double precision.
+// If quantize is true, the unpremultiplied values are rounded to 8 bits, as the lookup tables are indexed with.
+svgren::image_type::pixel_type apply_reference(
+		const std::array<channel_function, 4>& funcs,
+		const svgren::image_type::pixel_type& px,
+		bool quantize
+	)
+{
+	std::array<double, 4> v{};
+	for(unsigned i = 0; i != v.size(); ++i){
+		double u = 0;
+		if(i == 3){
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			u = double(px.a()) / 0xff;
+		}else if(px.a() != 0){
+			u = double(px[i]) / double(px.a());
+			if(quantize){
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				u = std::round(u * 0xff) / 0xff;
+			}
+		}
+		v[i] = std::clamp(funcs[i](u), 0.0, 1.0);
+	}
+
+	svgren::image_type::pixel_type ret;
+	for(unsigned i = 0; i != 3; ++i){
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret[i] = uint8_t(std::lround(v[i] * v[3] * 0xff));
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	ret.a() = uint8_t(std::lround(v[3] * 0xff));
+
+	return ret;
+}
+}
+
+namespace{
+// random pixels, all colors with alpha 0 and 1, and all alpha values with colors from 0 to alpha
+std::vector<svgren::image_type::pixel_type> make_test_pixels(){
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	auto random = make_random_image({64, 16}, 1);
+
+	std::vector<svgren::image_type::pixel_type> ret(random.pixels().begin(), random.pixels().end());
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	for(unsigned c = 0; c <= 0xff; ++c){
+		ret.push_back({0, 0, 0, 0});
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret.push_back({uint8_t(c), uint8_t(0xff - c), uint8_t(c / 2), 0xff});
+		ret.push_back({0, uint8_t(c / 2), uint8_t(c), uint8_t(c)});
+	}
+
+	return ret;
+}
+}
+
+namespace{
+const tst::set set("channel_luts", [](tst::suite& suite){
+	suite.add<std::string>(
+		"luts_are_close_to_float_reference",
+		{"identity", "table", "discrete", "linear", "gamma"},
+		[](const auto& p){
+			const auto& func = functions.at(p);
+			const auto& identity = functions.at("identity");
+
+			auto src = make_test_pixels();
+
+			// the function is applied to color channels only, and to all channels including alpha
+			for(bool alpha_too : {false, true}){
+				std::array<channel_function, 4> funcs = {func, func, func, alpha_too ? func : identity};
+
+				auto luts = make_luts(funcs);
+
+				std::vector<svgren::image_type::pixel_type> dst(src.size());
+				luts.apply(utki::make_span(dst), utki::make_span(src));
+
+				// The discrete function is not continuous, rounding of unpremultiplied value to 8 bits
+				// can move it to the next step, so it is only compared to the reference which does the same rounding.
+				for(bool quantize : {true, false}){
+					if(!quantize && p == "discrete"){
+						continue;
+					}
+
+					// lookup tables have limited precision, the reference rounds once
+					const unsigned tolerance = 1;
+
+					for(size_t i = 0; i != src.size(); ++i){
+						auto expected = apply_reference(funcs, src[i], quantize);
+						for(unsigned c = 0; c != expected.size(); ++c){
+							tst::check(std::abs(int(dst[i][c]) - int(expected[c])) <= int(tolerance), SL)
+									<< "pixel #" << i << ", channel = " << c << ", src = " << src[i]
+									<< ", alpha too = " << alpha_too << ", quantize = " << quantize
+									<< ", expected = " << unsigned(expected[c]) << ", actual = " << unsigned(dst[i][c]);
+						}
+					}
+				}
+
+				// applying in place gives the same results
+				std::vector<svgren::image_type::pixel_type> in_place = src;
+				luts.apply(utki::make_span(in_place), utki::make_span(in_place));
+				tst::check(in_place == dst, SL) << "alpha too = " << alpha_too;
+			}
+		}
+	);
+});
+}
@@ -0,0 +1,236 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../src/svgren/color_matrix.hxx"
+
+#include "util.hxx"
+
+namespace{
+// rows of the 5x4 color matrix
+using matrix_type = std::array<std::array<double, 5>, 4>;
+
+svgren::color_matrix_kernel make_kernel(const matrix_type& matrix){
+	r4::matrix4<svgren::real> m;
+	r4::vector4<svgren::real> mc5;
+	for(unsigned i = 0; i != matrix.size(); ++i){
+		for(unsigned j = 0; j != m[i].size(); ++j){
+			m[i][j] = svgren::real(matrix[i][j]);
+		}
+		mc5[i] = svgren::real(matrix[i][4]);
+	}
+	return {m, mc5};
+}
+
+// unpremultiply, apply the matrix, clamp and premultiply, all in double precision
+svgren::image_type::pixel_type apply_reference(const matrix_type& matrix, const svgren::image_type::pixel_type& px){
+	std::array<double, 4> u{};
+	for(unsigned i = 0; i != 3; ++i){
+		u[i] = px.a() == 0 ? 0 : double(px[i]) / double(px.a());
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	u[3] = double(px.a()) / 0xff;
+
+	std::array<double, 4> v{};
+	for(unsigned i = 0; i != v.size(); ++i){
+		v[i] = matrix[i][4];
+		for(unsigned j = 0; j != u.size(); ++j){
+			v[i] += matrix[i][j] * u[j];
+		}
+		v[i] = std::clamp(v[i], 0.0, 1.0);
+	}
+
+	svgren::image_type::pixel_type ret;
+	for(unsigned i = 0; i != 3; ++i){
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret[i] = uint8_t(std::lround(v[i] * v[3] * 0xff));
+	}
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	ret.a() = uint8_t(std::lround(v[3] * 0xff));
+
+	return ret;
+}
+
+// random pixels followed by all alpha values with colors from 0 to alpha
+std::vector<svgren::image_type::pixel_type> make_test_pixels(){
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	auto random = make_random_image({64, 16}, 1);
+
+	std::vector<svgren::image_type::pixel_type> ret(random.pixels().begin(), random.pixels().end());
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	for(unsigned a = 0; a <= 0xff; ++a){
+		ret.push_back({0, uint8_t(a / 2), uint8_t(a), uint8_t(a)});
+	}
+
+	return ret;
+}
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+const matrix_type identity = {{
+	{1, 0, 0, 0, 0},
+	{0, 1, 0, 0, 0},
+	{0, 0, 1, 0, 0},
+	{0, 0, 0, 1, 0}
+}};
+
+// hueRotate by a tiny angle, differs from identity by less than float precision of the kernel
+const matrix_type almost_identity = {{
+	{1, 1e-7, 0, 0, 0},
+	{0, 1, -1e-7, 0, 0},
+	{0, 0, 1, 0, 0},
+	{0, 0, 0, 1, 1e-7}
+}};
+
+// luminanceToAlpha
+const matrix_type luminance_to_alpha = {{
+	{0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0},
+	{0.2125, 0.7154, 0.0721, 0, 0}
+}};
+
+// alpha is scaled and offset, colors become black
+const matrix_type alpha_only = {{
+	{0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0},
+	{0.1, 0.2, 0.3, 0.5, 0.1}
+}};
+
+// slopes are not greater than 1, so that integer lookup tables stay within 1 of the float result
+const matrix_type diagonal = {{
+	{0.5, 0, 0, 0, 0.25},
+	{0, -1, 0, 0, 1},
+	{0, 0, 0.9, 0, 0},
+	{0, 0, 0, 0.8, 0.1}
+}};
+
+const matrix_type diagonal_alpha_only = {{
+	{1, 0, 0, 0, 0},
+	{0, 1, 0, 0, 0},
+	{0, 0, 1, 0, 0},
+	{0, 0, 0, 0.5, 0}
+}};
+
+// saturate with s = 0.3
+const matrix_type saturate = {{
+	{0.213 + 0.787 * 0.3, 0.715 - 0.715 * 0.3, 0.072 - 0.072 * 0.3, 0, 0},
+	{0.213 - 0.213 * 0.3, 0.715 + 0.285 * 0.3, 0.072 - 0.072 * 0.3, 0, 0},
+	{0.213 - 0.213 * 0.3, 0.715 - 0.715 * 0.3, 0.072 + 0.928 * 0.3, 0, 0},
+	{0, 0, 0, 1, 0}
+}};
+
+// all channels affect all channels, with results out of [0, 1] range
+const matrix_type general = {{
+	{0.5, 0.6, -0.4, 0.3, 0.1},
+	{-0.2, 1.5, 0.3, -0.1, 0},
+	{0.1, 0.1, 0.1, 0.9, -0.3},
+	{0.3, -0.2, 0.4, 0.7, 0.05}
+}};
+// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+}
+
+namespace{
+const tst::set set("color_matrix", [](tst::suite& suite){
+	suite.add(
+		"kind_is_detected",
+		[](){
+			using kind = svgren::color_matrix_kernel::kind;
+
+			tst::check(make_kernel(identity).get_kind() == kind::identity, SL);
+			tst::check(make_kernel(almost_identity).get_kind() == kind::identity, SL);
+			tst::check(make_kernel(luminance_to_alpha).get_kind() == kind::alpha_only, SL);
+			tst::check(make_kernel(alpha_only).get_kind() == kind::alpha_only, SL);
+			tst::check(make_kernel(diagonal).get_kind() == kind::diagonal, SL);
+			tst::check(make_kernel(diagonal_alpha_only).get_kind() == kind::diagonal, SL);
+			tst::check(make_kernel(saturate).get_kind() == kind::general, SL);
+			tst::check(make_kernel(general).get_kind() == kind::general, SL);
+
+			// an offset of any color channel makes the matrix not alpha-only
+			auto m = luminance_to_alpha;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			m[1][4] = 0.5;
+			tst::check(make_kernel(m).get_kind() == kind::general, SL);
+		}
+	);
+
+	suite.add<std::string>(
+		"kernel_is_close_to_float_reference",
+		{"identity", "luminance_to_alpha", "alpha_only", "diagonal", "diagonal_alpha_only", "saturate", "general"},
+		[](const auto& p){
+			const std::map<std::string, const matrix_type*> matrices = {
+				{"identity", &identity},
+				{"luminance_to_alpha", &luminance_to_alpha},
+				{"alpha_only", &alpha_only},
+				{"diagonal", &diagonal},
+				{"diagonal_alpha_only", &diagonal_alpha_only},
+				{"saturate", &saturate},
+				{"general", &general}
+			};
+			const auto& matrix = *matrices.at(p);
+
+			auto kernel = make_kernel(matrix);
+
+			auto src = make_test_pixels();
+			std::vector<svgren::image_type::pixel_type> dst(src.size());
+
+			kernel.apply(utki::make_span(dst), utki::make_span(src));
+
+			// lookup tables of diagonal matrices use integer unpremultiplied values, float path rounds once
+			const unsigned tolerance = 1;
+
+			for(size_t i = 0; i != src.size(); ++i){
+				auto expected = apply_reference(matrix, src[i]);
+				for(unsigned c = 0; c != expected.size(); ++c){
+					tst::check(std::abs(int(dst[i][c]) - int(expected[c])) <= int(tolerance), SL)
+							<< "pixel #" << i << ", channel = " << c
+							<< ", expected = " << unsigned(expected[c]) << ", actual = " << unsigned(dst[i][c]);
+				}
+			}
+		}
+	);
+
+	suite.add(
+		"general_rows_match_single_pixels",
+		[](){
+			// Rows are processed several pixels at once by SIMD code and the rest by per-pixel code,
+			// a single pixel row is processed only by per-pixel code. Both must give same results.
+			for(const auto& matrix : {saturate, general}){
+				auto kernel = make_kernel(matrix);
+
+				auto pixels = make_test_pixels();
+
+				std::vector<svgren::image_type::pixel_type> expected(pixels.size());
+				for(size_t i = 0; i != pixels.size(); ++i){
+					kernel.apply(utki::make_span(&expected[i], 1), utki::make_span(&pixels[i], 1));
+				}
+
+				// row lengths leave from 0 to 3 pixels after groups of 4 pixels
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				for(size_t length : {1, 2, 3, 4, 5, 6, 7, 8, 33}){
+					std::vector<svgren::image_type::pixel_type> dst(pixels.size());
+
+					for(size_t begin = 0; begin < pixels.size(); begin += length){
+						auto n = std::min(length, pixels.size() - begin);
+						kernel.apply(utki::make_span(&dst[begin], n), utki::make_span(&pixels[begin], n));
+					}
+
+					for(size_t i = 0; i != pixels.size(); ++i){
+						tst::check(dst[i] == expected[i], SL) << "pixel #" << i << ", row length = " << length;
+					}
+				}
+
+				// in place
+				kernel.apply(utki::make_span(pixels), utki::make_span(pixels));
+				tst::check(pixels == expected, SL);
+			}
+		}
+	);
+});
+}
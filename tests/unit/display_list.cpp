@@ -0,0 +1,70 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/display_list.hpp"
+
+#include "util.hxx"
+
+namespace{
+const unsigned tolerance = 10;
+
+const std::string data_dir = "samples_data/";
+}
+
+namespace{
+const tst::set set("display_list", [](tst::suite& suite){
+	auto files = list_svg_files(data_dir);
+
+	suite.add<std::string>(
+		"display_list_rasterization_matches_direct_rasterization",
+		files,
+		[](const auto& p){
+			auto dom = svgdom::load(fsif::native_file(data_dir + p));
+
+			svgren::prepared_document doc(*dom);
+
+			svgren::display_list dl(doc);
+
+			check_close(svgren::rasterize(doc), svgren::rasterize(dl), tolerance, p);
+
+			// the display list is resolution independent, check it with different raster dimensions
+			svgren::parameters params;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.dims_request.x() = 123;
+
+			check_close(svgren::rasterize(doc, params), svgren::rasterize(dl, params), tolerance, p);
+		}
+	);
+
+	suite.add(
+		"batch_rasterization_matches_separate_rasterizations",
+		[](){
+			auto dom = svgdom::load(fsif::native_file(data_dir + "camera.svg"));
+
+			std::vector<svgren::parameters> params;
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			for(unsigned size : {16, 24, 32, 48, 64, 128, 256, 512}){
+				auto& p = params.emplace_back();
+				p.dims_request = size;
+			}
+
+			// also check that different DPIs are handled
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.emplace_back().dpi = 200;
+
+			const unsigned num_threads = 4;
+
+			auto images = svgren::rasterize(*dom, utki::make_span(params), num_threads);
+
+			tst::check_eq(images.size(), params.size(), SL);
+
+			for(size_t i = 0; i != params.size(); ++i){
+				check_close(svgren::rasterize(*dom, params[i]), images[i], tolerance, "camera.svg");
+			}
+		}
+	);
+});
+}
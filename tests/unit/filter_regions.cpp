@@ -0,0 +1,141 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+#include "util.hxx"
+
+namespace{
+// Filter whose last primitive has a subregion. Only part of the results of the preceding primitives
+// is needed for it, so only that part is computed. Without the subregion of the last primitive
+// the whole results are needed, which gives the reference image.
+struct region_case{
+	std::string primitive_units;
+
+	// primitives, the last one has SUBREGION placeholder for its subregion attributes
+	std::string primitives;
+
+	std::string subregion;
+
+	// pixels surely inside of the subregion
+	r4::rectangle<unsigned> inner;
+};
+
+const std::vector<region_case> region_cases = {
+	// last primitive needs part of a blur
+	{
+		"userSpaceOnUse",
+		R"(
+			<feGaussianBlur in="SourceGraphic" stdDeviation="3" result="b"/>
+			<feComposite in="b" in2="SourceGraphic" operator="over" SUBREGION/>
+		)",
+		R"(x="20" y="30" width="30" height="20")",
+		{{20, 30}, {30, 20}}
+	},
+	// blur of a blur, the needed region grows by the reach of both blurs,
+	// the subregion touches the right edge of the filter region
+	{
+		"userSpaceOnUse",
+		R"(
+			<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="b1"/>
+			<feColorMatrix in="b1" type="hueRotate" values="90"/>
+			<feGaussianBlur stdDeviation="3" result="b2"/>
+			<feBlend in="b2" in2="b1" mode="multiply" SUBREGION/>
+		)",
+		R"(x="60" y="5" width="36" height="30")",
+		{{60, 5}, {36, 30}}
+	},
+	// preceding primitives have subregions of their own
+	{
+		"userSpaceOnUse",
+		R"(
+			<feGaussianBlur in="SourceGraphic" stdDeviation="2" x="15" y="15" width="50" height="40" result="b"/>
+			<feColorMatrix in="SourceGraphic" type="saturate" values="0.2" x="40" y="0" width="56" height="80" result="c"/>
+			<feComposite in="b" in2="c" operator="xor" SUBREGION/>
+		)",
+		R"(x="30" y="20" width="40" height="40")",
+		{{30, 20}, {40, 40}}
+	},
+	// subregions as fractions of the bounding box of the group, which is from (10, 10) to (80, 65)
+	{
+		"objectBoundingBox",
+		R"(
+			<feGaussianBlur in="SourceGraphic" stdDeviation="0.03" x="0.1" y="0.2" width="0.6" height="0.5" result="b"/>
+			<feBlend in="b" in2="SourceGraphic" mode="lighten" SUBREGION/>
+		)",
+		R"(x="0.3" y="0.3" width="0.5" height="0.4")",
+		// from (31, 26.5) to (66, 48.5)
+		{{31, 27}, {35, 21}}
+	}
+};
+
+std::string with_subregion(const std::string& primitives, std::string_view subregion){
+	auto ret = primitives;
+	ret.replace(ret.find("SUBREGION"), std::string_view("SUBREGION").size(), subregion);
+	return ret;
+}
+
+bool is_transparent(const svgren::image_type::pixel_type& px){
+	return px == svgren::image_type::pixel_type{0, 0, 0, 0};
+}
+}
+
+namespace{
+const tst::set set("filter_regions", [](tst::suite& suite){
+	suite.add<unsigned>(
+		"partial_regions_give_same_pixels_as_full_regions",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{0, 1, 2, 3},
+		[](const auto& p){
+			const auto& c = region_cases.at(p);
+
+			auto partial_dom = svgdom::load(make_filter_document(with_subregion(c.primitives, c.subregion), c.primitive_units));
+			auto full_dom = svgdom::load(make_filter_document(with_subregion(c.primitives, ""), c.primitive_units));
+
+			tst::check(partial_dom != nullptr, SL);
+			tst::check(full_dom != nullptr, SL);
+
+			svgren::rasterization_stats partial_stats;
+			svgren::rasterization_stats full_stats;
+
+			svgren::parameters params;
+			// the automatic choice of the blur algorithm depends on the blurred region size
+			params.blur = svgren::blur_algorithm::box;
+
+			params.stats = &partial_stats;
+			auto partial = svgren::rasterize(*partial_dom, params);
+
+			params.stats = &full_stats;
+			auto full = svgren::rasterize(*full_dom, params);
+
+			tst::check_eq(partial.dims(), full.dims(), SL);
+
+			// inside of the subregion the pixels are same, outside of it there is nothing
+			for(unsigned y = 0; y != full.dims().y(); ++y){
+				for(unsigned x = 0; x != full.dims().x(); ++x){
+					const auto& pp = partial.span()[y][x];
+					const auto& fp = full.span()[y][x];
+
+					bool inside = x >= c.inner.p.x() && x < c.inner.p.x() + c.inner.d.x() &&
+							y >= c.inner.p.y() && y < c.inner.p.y() + c.inner.d.y();
+
+					if(inside){
+						tst::check(pp == fp, SL)
+								<< "case #" << p << ", pixel (" << x << ", " << y << ")";
+					}else{
+						// pixels on the subregion border may be inside or outside depending on rounding
+						tst::check(pp == fp || is_transparent(pp), SL)
+								<< "case #" << p << ", pixel (" << x << ", " << y << ")";
+					}
+				}
+			}
+
+			// only the needed parts of the results are computed
+			tst::check(partial_stats.num_filter_pixels < full_stats.num_filter_pixels, SL)
+					<< "case #" << p
+					<< ", partial = " << partial_stats.num_filter_pixels
+					<< ", full = " << full_stats.num_filter_pixels;
+		}
+	);
+});
+}
@@ -0,0 +1,275 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+#include "util.hxx"
+
+namespace{
+// filter primitives which refer to each other's results in different ways
+const std::vector<std::string> filters = {
+	// named result is used by primitives which are far after it
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="blur"/>
+		<feColorMatrix in="SourceGraphic" type="hueRotate" values="90" result="rotated"/>
+		<feGaussianBlur in="rotated" stdDeviation="1"/>
+		<feBlend in2="blur" mode="screen" result="screened"/>
+		<feComposite in="blur" in2="screened" operator="xor"/>
+		<feComposite in2="rotated" operator="atop"/>
+	)",
+	// result names are reused, an input refers to the latest result with the name
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="3" result="a"/>
+		<feColorMatrix in="a" type="saturate" values="0.2" result="b"/>
+		<feComposite in="SourceGraphic" in2="a" operator="in" result="a"/>
+		<feBlend in="a" in2="b" mode="multiply" result="b"/>
+		<feComposite in="b" in2="a" operator="over"/>
+	)",
+	// results which nothing uses
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="unused"/>
+		<feColorMatrix in="SourceGraphic" type="saturate" values="0.5" result="used"/>
+		<feGaussianBlur in="SourceGraphic" stdDeviation="4" result="unused"/>
+		<feColorMatrix in="used" type="hueRotate" values="30"/>
+		<feComposite in2="SourceGraphic" operator="arithmetic" k1="0.5" k2="0.5" k3="0.5" k4="0"/>
+	)",
+	// long chain, each result is used only by the next primitive
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+		<feGaussianBlur stdDeviation="1"/>
+	)"
+};
+
+// Chains of color matrices feeding blend or composite. Each color matrix is used only by the next
+// primitive, so it is fused into it. The extra primitives use the color matrix results once more,
+// which prevents the fusion, but do not change the filter result.
+struct fusion_case{
+	std::string chain;
+	std::string extra;
+};
+
+const std::vector<fusion_case> fusion_cases = {
+	// three color matrices feeding the 'in' of blend
+	{
+		R"(
+			<feColorMatrix in="SourceGraphic" type="hueRotate" values="60" result="m1"/>
+			<feColorMatrix in="m1" type="saturate" values="0.4" result="m2"/>
+			<feColorMatrix in="m2" type="matrix" values="0.5 0.2 0.1 0 0.1  0.1 0.8 0 0 0  0 0.3 0.6 0 0.05  0 0 0 0.9 0" result="m3"/>
+			<feBlend in="m3" in2="SourceGraphic" mode="multiply" result="out"/>
+		)",
+		R"(
+			<feBlend in="m1" in2="m2" result="extra"/>
+			<feBlend in="m3" in2="extra" result="extra"/>
+		)"
+	},
+	// two color matrices feeding the 'in2' of composite
+	{
+		R"(
+			<feColorMatrix in="SourceGraphic" type="luminanceToAlpha" result="m1"/>
+			<feColorMatrix in="m1" type="matrix" values="0 0 0 0 1  0 0 0 0 0.5  0 0 0 0 0  0 0 0 1 0" result="m2"/>
+			<feComposite in="SourceGraphic" in2="m2" operator="arithmetic" k1="0.3" k2="0.6" k3="0.4" k4="0.01" result="out"/>
+		)",
+		R"(
+			<feComposite in="m1" in2="m2" operator="over" result="extra"/>
+		)"
+	},
+	// three color matrices feeding composite, alpha is scaled, so premultiplied colors change
+	{
+		R"(
+			<feColorMatrix in="SourceGraphic" type="matrix" values="1 0 0 0 0  0 1 0 0 0  0 0 1 0 0  0 0 0 0.5 0" result="m1"/>
+			<feColorMatrix in="m1" type="hueRotate" values="180" result="m2"/>
+			<feColorMatrix in="m2" type="saturate" values="2" result="m3"/>
+			<feComposite in="m3" in2="SourceGraphic" operator="xor" result="out"/>
+		)",
+		R"(
+			<feBlend in="m1" in2="m2" mode="screen" result="extra"/>
+			<feBlend in="m3" in2="extra" mode="darken" result="extra"/>
+		)"
+	},
+	// the 'in' of blend is empty, the blend must still take the fused 'in2'
+	{
+		R"(
+			<feColorMatrix in="SourceGraphic" x="200" y="0" width="10" height="10" type="saturate" values="0" result="empty"/>
+			<feColorMatrix in="SourceGraphic" type="hueRotate" values="90" result="m1"/>
+			<feColorMatrix in="m1" type="saturate" values="0.5" result="m2"/>
+			<feBlend in="empty" in2="m2" mode="screen" result="out"/>
+		)",
+		R"(
+			<feBlend in="m1" in2="m2" result="extra"/>
+		)"
+	}
+};
+
+// final primitive, its result is the result of the filter
+const std::string fusion_final = R"(
+	<feComposite in="out" in2="SourceGraphic" operator="atop"/>
+)";
+}
+
+namespace{
+// Blend and composite write their result over the pixels of an input which is not used afterwards.
+// In these filters an input must not be overwritten, because it is read later directly or through a view.
+const std::vector<std::string> in_place_filters = {
+	// the input is still viewed, identity color matrix result is a view of the blur result
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="blur"/>
+		<feColorMatrix in="blur" type="hueRotate" values="0" result="view"/>
+		<feBlend in="blur" in2="SourceGraphic" mode="screen" result="screened"/>
+		<feComposite in="view" in2="screened" operator="over" result="c"/>
+		<feComposite in="view" in2="c" operator="xor"/>
+	)",
+	// the inputs are needed later, only their last users can overwrite them
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="blur"/>
+		<feColorMatrix in="SourceGraphic" type="saturate" values="0.3" result="saturated"/>
+		<feBlend in="blur" in2="saturated" mode="multiply" result="multiplied"/>
+		<feComposite in="saturated" in2="blur" operator="atop" result="c"/>
+		<feComposite in="blur" in2="multiplied" operator="arithmetic" k1="0.5" k2="0.3" k3="0.4" k4="0.05" result="a"/>
+		<feBlend in="c" in2="a" mode="darken"/>
+	)",
+	// same result is both inputs, directly and through a view
+	R"(
+		<feGaussianBlur in="SourceGraphic" stdDeviation="2" result="blur"/>
+		<feColorMatrix in="blur" type="hueRotate" values="0" result="view"/>
+		<feComposite in="blur" in2="blur" operator="arithmetic" k1="0.5" k2="0.3" k3="0.4" k4="0.05" result="a"/>
+		<feBlend in="a" in2="a" mode="multiply" result="b"/>
+		<feComposite in="view" in2="blur" operator="xor" result="c"/>
+		<feBlend in="b" in2="c" mode="screen"/>
+	)"
+};
+}
+
+namespace{
+const tst::set set("filter_results", [](tst::suite& suite){
+	suite.add<unsigned>(
+		"released_results_give_same_image",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{0, 1, 2, 3},
+		[](const auto& p){
+			auto dom = svgdom::load(make_filter_document(filters.at(p)));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::rasterization_stats kept_stats;
+			svgren::rasterization_stats released_stats;
+
+			svgren::parameters params;
+
+			params.filter_result_release = false;
+			params.stats = &kept_stats;
+			auto kept = svgren::rasterize(*dom, params);
+
+			params.filter_result_release = true;
+			params.stats = &released_stats;
+			auto released = svgren::rasterize(*dom, params);
+
+			tst::check_eq(released.dims(), kept.dims(), SL);
+			tst::check(released.pixels() == kept.pixels(), SL) << "filter #" << p;
+
+			tst::check_eq(released_stats.num_filter_primitives, kept_stats.num_filter_primitives, SL);
+
+			tst::check(released_stats.peak_filter_memory != 0, SL);
+			tst::check(released_stats.peak_filter_memory <= kept_stats.peak_filter_memory, SL)
+					<< "filter #" << p
+					<< ", released = " << released_stats.peak_filter_memory
+					<< ", kept = " << kept_stats.peak_filter_memory;
+		}
+	);
+
+	suite.add(
+		"released_results_take_less_memory_in_long_chain",
+		[](){
+			// chain of 8 blurs, without releasing all 8 results are kept
+			auto dom = svgdom::load(make_filter_document(filters.back()));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::rasterization_stats kept_stats;
+			svgren::rasterization_stats released_stats;
+
+			svgren::parameters params;
+
+			params.filter_result_release = false;
+			params.stats = &kept_stats;
+			svgren::rasterize(*dom, params);
+
+			params.filter_result_release = true;
+			params.stats = &released_stats;
+			svgren::rasterize(*dom, params);
+
+			// at most the current result, its input, the temporary image and two released images for reuse
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			const size_t max_images = 5;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			const size_t image_size = size_t(96) * 80 * sizeof(svgren::image_type::pixel_type);
+
+			tst::check(released_stats.peak_filter_memory <= max_images * image_size, SL)
+					<< "released = " << released_stats.peak_filter_memory;
+			tst::check(released_stats.peak_filter_memory < kept_stats.peak_filter_memory, SL)
+					<< "released = " << released_stats.peak_filter_memory
+					<< ", kept = " << kept_stats.peak_filter_memory;
+		}
+	);
+
+	suite.add<unsigned>(
+		"in_place_results_give_same_image",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{0, 1, 2},
+		[](const auto& p){
+			auto dom = svgdom::load(make_filter_document(in_place_filters.at(p)));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::parameters params;
+
+			// without releasing, no result is written over its input
+			params.filter_result_release = false;
+			auto allocated = svgren::rasterize(*dom, params);
+
+			params.filter_result_release = true;
+			auto in_place = svgren::rasterize(*dom, params);
+
+			tst::check_eq(in_place.dims(), allocated.dims(), SL);
+			tst::check(in_place.pixels() == allocated.pixels(), SL) << "filter #" << p;
+		}
+	);
+
+	suite.add<unsigned>(
+		"fused_color_matrices_give_same_image",
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		{0, 1, 2, 3},
+		[](const auto& p){
+			const auto& c = fusion_cases.at(p);
+
+			auto fused_dom = svgdom::load(make_filter_document(c.chain + fusion_final));
+			auto unfused_dom = svgdom::load(make_filter_document(c.chain + c.extra + fusion_final));
+
+			tst::check(fused_dom != nullptr, SL);
+			tst::check(unfused_dom != nullptr, SL);
+
+			svgren::rasterization_stats fused_stats;
+			svgren::rasterization_stats unfused_stats;
+
+			svgren::parameters params;
+
+			params.stats = &fused_stats;
+			auto fused = svgren::rasterize(*fused_dom, params);
+
+			params.stats = &unfused_stats;
+			auto unfused = svgren::rasterize(*unfused_dom, params);
+
+			tst::check_eq(fused.dims(), unfused.dims(), SL);
+			tst::check(fused.pixels() == unfused.pixels(), SL) << "case #" << p;
+
+			// fused primitives do not store their results
+			tst::check(fused_stats.num_filter_pixels < unfused_stats.num_filter_pixels, SL) << "case #" << p;
+		}
+	);
+});
+}
@@ -0,0 +1,48 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+namespace{
+const tst::set set("filter_threads", [](tst::suite& suite){
+	suite.add<std::string>(
+		"multithreaded_filters_match_single_threaded",
+		{
+			"samples_data/car.svg",
+			"samples_data/composite.svg",
+			"samples_data/dropshadowfilter.svg",
+			"samples_data/gauge_arrow_shadow.svg",
+			"samples_data/machupicchu_collection_01.svg"
+		},
+		[](const auto& p){
+			auto dom = svgdom::load(fsif::native_file(p));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::prepared_document doc(*dom);
+
+			svgren::parameters params;
+			// large image, so that filter regions are big enough to be split between threads
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.dims_request.x() = 1024;
+
+			auto expected = svgren::rasterize(doc, params);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.num_filter_threads = 4;
+
+			auto im = svgren::rasterize(doc, params);
+
+			tst::check_eq(im.dims(), expected.dims(), SL);
+
+			// every pixel is computed the same way regardless of how rows and columns
+			// are split between threads, so the results must be exactly the same
+			for(size_t i = 0; i != im.pixels().size(); ++i){
+				tst::check(im.pixels()[i] == expected.pixels()[i], SL) << "pixel #" << i << " differs, file = " << p;
+			}
+		}
+	);
+});
+}
@@ -0,0 +1,155 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <vector>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+namespace{
+bool is_transparent(const svgren::image_type& img){
+	for(const auto& px : img.pixels()){
+		if(px.a() != 0){
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+namespace{
+const tst::set set("limits", [](tst::suite& suite){
+	suite.add(
+		"zero_element_visits_limit_gives_empty_image",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::parameters p;
+			p.limits.max_element_visits = 0;
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), svgren::get_raster_dims(*dom), SL);
+			tst::check(is_transparent(img), SL);
+		}
+	);
+
+	suite.add(
+		"element_visits_limit_skips_elements",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			auto unlimited = svgren::rasterize(*dom);
+
+			svgren::parameters p;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			p.limits.max_element_visits = 5;
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), unlimited.dims(), SL);
+			tst::check(img.pixels() != unlimited.pixels(), SL);
+		}
+	);
+
+	suite.add(
+		"blur_size_limit_skips_blurred_elements",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/gauge_arrow_shadow.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			auto unlimited = svgren::rasterize(*dom);
+
+			svgren::parameters p;
+			p.limits.max_blur_size = 1;
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), unlimited.dims(), SL);
+			tst::check(img.pixels() != unlimited.pixels(), SL);
+		}
+	);
+
+	suite.add(
+		"filter_memory_limit_skips_filtered_elements",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/dropshadowfilter.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			auto unlimited = svgren::rasterize(*dom);
+
+			svgren::parameters p;
+			p.limits.max_filter_memory = 1;
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), unlimited.dims(), SL);
+			tst::check(img.pixels() != unlimited.pixels(), SL);
+		}
+	);
+
+	suite.add(
+		"batch_rasterization_applies_limits",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/mouse.svg"));
+			auto blurred_dom = svgdom::load(fsif::native_file("samples_data/gauge_arrow_shadow.svg"));
+
+			tst::check(dom != nullptr, SL);
+			tst::check(blurred_dom != nullptr, SL);
+
+			// limits checked while compiling the display list
+			{
+				std::vector<svgren::parameters> params(3);
+				params[1].limits.max_element_visits = 0;
+				params[2].limits.max_use_depth = 0;
+
+				auto imgs = svgren::rasterize(*dom, utki::make_span(params));
+
+				tst::check_eq(imgs.size(), params.size(), SL);
+				tst::check_eq(imgs[1].dims(), imgs[0].dims(), SL);
+				tst::check(is_transparent(imgs[1]), SL);
+				tst::check_eq(imgs[2].dims(), imgs[0].dims(), SL);
+				tst::check(imgs[2].pixels() != imgs[0].pixels(), SL);
+			}
+
+			// limits checked while rasterizing the display list, the blurred elements are skipped
+			{
+				std::vector<svgren::parameters> params(2);
+				params[1].limits.max_blur_size = 1;
+
+				auto imgs = svgren::rasterize(*blurred_dom, utki::make_span(params));
+
+				tst::check_eq(imgs.size(), params.size(), SL);
+				tst::check_eq(imgs[1].dims(), imgs[0].dims(), SL);
+				tst::check(imgs[1].pixels() != imgs[0].pixels(), SL);
+			}
+		}
+	);
+
+	suite.add(
+		"zero_use_depth_limit_skips_use_elements",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/mouse.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			auto unlimited = svgren::rasterize(*dom);
+
+			svgren::parameters p;
+			p.limits.max_use_depth = 0;
+
+			auto img = svgren::rasterize(*dom, p);
+
+			tst::check_eq(img.dims(), unlimited.dims(), SL);
+			tst::check(img.pixels() != unlimited.pixels(), SL);
+		}
+	);
+});
+}
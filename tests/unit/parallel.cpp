@@ -0,0 +1,88 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../../src/svgren/parallel.hxx"
+
+namespace{
+const tst::set set("parallel", [](tst::suite& suite){
+	suite.add(
+		"parallel_for_invokes_function_for_each_index",
+		[](){
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			std::vector<std::atomic<unsigned>> calls(1000);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			for(unsigned num_threads : {0, 1, 2, 4, 16}){
+				for(auto& c : calls){
+					c = 0;
+				}
+
+				svgren::parallel_for(num_threads, calls.size(), [&](size_t i){
+					++calls[i];
+				});
+
+				for(size_t i = 0; i != calls.size(); ++i){
+					tst::check_eq(unsigned(calls[i]), 1u, SL) << "i = " << i << ", num_threads = " << num_threads;
+				}
+			}
+		}
+	);
+
+	suite.add(
+		"nested_parallel_for_from_several_threads",
+		[](){
+			// Filters run in parallel inside of tiles which are rasterized in parallel,
+			// so pool threads call parallel_for() while the pool is busy.
+			std::atomic<size_t> sum = 0;
+
+			const unsigned num_outer_threads = 4;
+			const size_t outer_count = 10;
+			const size_t inner_count = 100;
+
+			std::vector<std::thread> threads;
+			for(unsigned t = 0; t != num_outer_threads; ++t){
+				threads.emplace_back([&](){
+					// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+					svgren::parallel_for(3, outer_count, [&](size_t i){
+						// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+						svgren::parallel_for(4, inner_count, [&](size_t j){
+							sum += i * j;
+						});
+					});
+				});
+			}
+			for(auto& t : threads){
+				t.join();
+			}
+
+			// sum of i * j over all i and j is the product of the sums
+			size_t expected = num_outer_threads * (outer_count * (outer_count - 1) / 2) * (inner_count * (inner_count - 1) / 2);
+			tst::check_eq(size_t(sum), expected, SL);
+		}
+	);
+
+	suite.add(
+		"parallel_for_rethrows_exception",
+		[](){
+			bool caught = false;
+			try{
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				svgren::parallel_for(4, 1000, [](size_t i){
+					// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+					if(i == 500){
+						throw std::runtime_error("error");
+					}
+				});
+			}catch(std::runtime_error&){
+				caught = true;
+			}
+			tst::check(caught, SL);
+		}
+	);
+});
+}
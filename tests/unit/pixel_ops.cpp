@@ -0,0 +1,231 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "../../src/svgren/pixel_ops.hxx"
+
+#include "util.hxx"
+
+namespace{
+using pixel_type = svgren::image_type::pixel_type;
+
+// premultiplied pixels covering fully transparent, fully opaque and translucent ones
+std::vector<pixel_type> make_test_pixels(){
+	std::vector<pixel_type> ret;
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	for(unsigned a : {0, 1, 2, 127, 128, 200, 254, 255}){
+		ret.push_back({0, uint8_t(a / 2), uint8_t(a), uint8_t(a)});
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		ret.push_back({uint8_t(a), uint8_t(a / 3), 0, uint8_t(a)});
+	}
+
+	// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+	auto random = make_random_image({8, 8}, 1);
+	ret.insert(ret.end(), random.pixels().begin(), random.pixels().end());
+
+	return ret;
+}
+
+// channel value from a fraction
+double to_channel(double v){
+	return v * svgren::channel_max;
+}
+
+// fraction from a channel value
+double to_fraction(unsigned v){
+	return double(v) / svgren::channel_max;
+}
+
+// Check operation on all pairs of test pixels, expected channel values are calculated from
+// the fractions of the input channel values.
+template <typename operation_type>
+void check_op(
+		const operation_type& op,
+		const std::function<double(double ca, double cb, double qa, double qb, unsigned channel)>& reference,
+		unsigned tolerance,
+		const std::string& name
+	)
+{
+	auto pixels = make_test_pixels();
+
+	for(const auto& a : pixels){
+		for(const auto& b : pixels){
+			auto actual = op(a, b);
+
+			for(unsigned i = 0; i != actual.size(); ++i){
+				auto expected = std::lround(to_channel(reference(
+						to_fraction(a[i]),
+						to_fraction(b[i]),
+						to_fraction(a.a()),
+						to_fraction(b.a()),
+						i
+					)));
+
+				tst::check(std::abs(long(actual[i]) - expected) <= long(tolerance), SL)
+						<< name << ": a = " << a.to<unsigned>() << ", b = " << b.to<unsigned>() << ", channel = " << i
+						<< ", expected = " << expected << ", actual = " << unsigned(actual[i]);
+			}
+		}
+	}
+}
+
+// reference of the arithmetic composite operator, the result is clamped to [0, 1]
+double arithmetic(double k1, double k2, double k3, double k4, double i1, double i2){
+	return std::clamp(k1 * i1 * i2 + k2 * i1 + k3 * i2 + k4, 0.0, 1.0);
+}
+}
+
+namespace{
+const tst::set set("pixel_ops", [](tst::suite& suite){
+	suite.add(
+		"div_255_is_exact",
+		[](){
+			// all values which the operations pass to div_255()
+			for(unsigned v = 0; v <= svgren::channel_max * svgren::channel_max; ++v){
+				auto expected = unsigned(std::lround(double(v) / svgren::channel_max));
+				tst::check_eq(svgren::div_255(v), expected, SL) << "v = " << v;
+			}
+
+			// products of all pairs of channel values
+			for(unsigned a = 0; a <= svgren::channel_max; ++a){
+				for(unsigned b = 0; b <= svgren::channel_max; ++b){
+					auto expected = unsigned(std::lround(double(a * b) / svgren::channel_max));
+					tst::check_eq(svgren::div_255(a * b), expected, SL) << "a = " << a << ", b = " << b;
+				}
+			}
+		}
+	);
+
+	suite.add(
+		"blend_op_matches_float_formula",
+		[](){
+			using mode = svgdom::fe_blend_element::mode;
+
+			// the integer operation calculates the formula exactly and rounds once, so there is no tolerance
+			auto with_alpha = [](auto color_formula){
+				return [color_formula](double ca, double cb, double qa, double qb, unsigned channel){
+					if(channel == 3){
+						return 1 - (1 - qa) * (1 - qb);
+					}
+					return color_formula(ca, cb, qa, qb);
+				};
+			};
+
+			check_op(svgren::blend_op<mode::normal>(), with_alpha([](double ca, double cb, double qa, double qb){
+				return (1 - qa) * cb + ca;
+			}), 0, "normal");
+			check_op(svgren::blend_op<mode::multiply>(), with_alpha([](double ca, double cb, double qa, double qb){
+				return (1 - qa) * cb + (1 - qb) * ca + ca * cb;
+			}), 0, "multiply");
+			check_op(svgren::blend_op<mode::screen>(), with_alpha([](double ca, double cb, double qa, double qb){
+				return cb + ca - ca * cb;
+			}), 0, "screen");
+			check_op(svgren::blend_op<mode::darken>(), with_alpha([](double ca, double cb, double qa, double qb){
+				return std::min((1 - qa) * cb + ca, (1 - qb) * ca + cb);
+			}), 0, "darken");
+			check_op(svgren::blend_op<mode::lighten>(), with_alpha([](double ca, double cb, double qa, double qb){
+				return std::max((1 - qa) * cb + ca, (1 - qb) * ca + cb);
+			}), 0, "lighten");
+		}
+	);
+
+	suite.add(
+		"composite_op_matches_float_formula",
+		[](){
+			using op = svgdom::fe_composite_element::operator_type;
+
+			// alpha is calculated by the same formula as colors, since pixels are premultiplied
+			check_op(svgren::composite_op<op::over>(), [](double ca, double cb, double qa, double qb, unsigned){
+				return ca + cb * (1 - qa);
+			}, 0, "over");
+			check_op(svgren::composite_op<op::in>(), [](double ca, double cb, double qa, double qb, unsigned){
+				return ca * qb;
+			}, 0, "in");
+			check_op(svgren::composite_op<op::out>(), [](double ca, double cb, double qa, double qb, unsigned){
+				return ca * (1 - qb);
+			}, 0, "out");
+			check_op(svgren::composite_op<op::atop>(), [](double ca, double cb, double qa, double qb, unsigned){
+				return ca * qb + cb * (1 - qa);
+			}, 0, "atop");
+			check_op(svgren::composite_op<op::xor_operator>(), [](double ca, double cb, double qa, double qb, unsigned){
+				return ca * (1 - qb) + cb * (1 - qa);
+			}, 0, "xor");
+		}
+	);
+
+	suite.add(
+		"composite_arithmetic_op_matches_float_formula",
+		[](){
+			// fixed-point coefficients are rounded, so results can differ by 1
+			const unsigned tolerance = 1;
+
+			// NOLINTBEGIN(cppcoreguidelines-avoid-magic-numbers)
+			std::vector<std::array<double, 4>> ks = {
+				{0, 1, 0, 0},
+				{0, 0, 1, 0},
+				{1, 0, 0, 0},
+				{0, 0, 0, 1},
+				{0.5, 0.25, 0.25, 0},
+				{-1, 2, 0.5, -0.25},
+				{3.7, -1.3, 0.9, 0.1},
+				{0, 0.5, 0.5, 0.5},
+				// largest coefficients handled in fixed-point
+				{double(1 << 24), 0, 0, -double(1 << 24)},
+				{0, double(1 << 24), -double(1 << 24), 0.25},
+				// just above the fixed-point range
+				{double(1 << 24) + 1, 0, 0, -double(1 << 24) - 1},
+				{0, 1e9, -1e9, 0.25}
+			};
+			// NOLINTEND(cppcoreguidelines-avoid-magic-numbers)
+
+			for(const auto& k : ks){
+				svgren::composite_arithmetic_op op(k[0], k[1], k[2], k[3]);
+
+				check_op(op, [&k](double ca, double cb, double, double, unsigned){
+					return arithmetic(k[0], k[1], k[2], k[3], ca, cb);
+				}, tolerance, "arithmetic");
+			}
+		}
+	);
+
+	suite.add(
+		"composite_arithmetic_op_keeps_ratios_of_huge_coefficients",
+		[](){
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			for(double huge : {1e10, 1e30}){
+				// result is 1 where i1 > i2, 0 where i1 < i2 and 0.25 where i1 == i2
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				svgren::composite_arithmetic_op compare(0, huge, -huge, 0.25);
+
+				// result is 0.25 where i1 == i2 == 1 and 0 elsewhere
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				svgren::composite_arithmetic_op product(huge, 0.25, 0, -huge);
+
+				for(unsigned a = 0; a <= svgren::channel_max; ++a){
+					// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+					for(unsigned b : {0u, a / 2, a, (a + svgren::channel_max) / 2, svgren::channel_max}){
+						pixel_type pa = {uint8_t(a), uint8_t(a), uint8_t(a), uint8_t(a)};
+						pixel_type pb = {uint8_t(b), uint8_t(b), uint8_t(b), uint8_t(b)};
+
+						// 0.25 of 255 is 63.75
+						// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+						const unsigned quarter = 64;
+
+						unsigned expected = a > b ? svgren::channel_max : a < b ? 0 : quarter;
+						tst::check_eq(unsigned(compare(pa, pb)[0]), expected, SL)
+								<< "huge = " << huge << ", a = " << a << ", b = " << b;
+
+						expected = a == svgren::channel_max && b == svgren::channel_max ? quarter : 0;
+						tst::check_eq(unsigned(product(pa, pb)[0]), expected, SL)
+								<< "huge = " << huge << ", a = " << a << ", b = " << b;
+					}
+				}
+			}
+		}
+	);
+});
+}
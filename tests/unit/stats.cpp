@@ -0,0 +1,93 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+namespace{
+const tst::set set("stats", [](tst::suite& suite){
+	suite.add(
+		"stats_are_collected",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::rasterization_stats stats;
+
+			svgren::parameters p;
+			p.stats = &stats;
+
+			svgren::rasterize(*dom, p);
+
+			tst::check(stats.num_elements != 0, SL);
+			tst::check(stats.num_path_segments != 0, SL);
+			tst::check(stats.num_fills + stats.num_strokes != 0, SL);
+			tst::check_eq(stats.num_groups_pushed, stats.num_groups_popped, SL);
+			tst::check_eq(stats.num_filter_primitives, size_t(0), SL);
+
+			// stats are added up
+			auto first_stats = stats;
+
+			svgren::rasterize(*dom, p);
+
+			tst::check_eq(stats.num_elements, first_stats.num_elements * 2, SL);
+			tst::check_eq(stats.num_path_segments, first_stats.num_path_segments * 2, SL);
+		}
+	);
+
+	suite.add(
+		"filter_stats_are_collected",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/dropshadowfilter.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::rasterization_stats stats;
+
+			svgren::parameters p;
+			p.stats = &stats;
+
+			svgren::rasterize(*dom, p);
+
+			tst::check(stats.num_filter_primitives != 0, SL);
+			tst::check(stats.num_filter_pixels != 0, SL);
+			tst::check(stats.peak_filter_memory != 0, SL);
+			tst::check(stats.num_groups_pushed != 0, SL);
+			tst::check_eq(stats.num_groups_pushed, stats.num_groups_popped, SL);
+		}
+	);
+
+	suite.add(
+		"stats_are_collected_from_all_tiles",
+		[](){
+			auto dom = svgdom::load(fsif::native_file("samples_data/camera.svg"));
+
+			tst::check(dom != nullptr, SL);
+
+			svgren::rasterization_stats single_stats;
+			{
+				svgren::parameters p;
+				p.stats = &single_stats;
+				svgren::rasterize(*dom, p);
+			}
+
+			svgren::rasterization_stats tiled_stats;
+			{
+				svgren::parameters p;
+				p.stats = &tiled_stats;
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				p.num_threads = 4;
+				// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+				p.tile_dims = decltype(p.tile_dims){16, 16};
+				svgren::rasterize(*dom, p);
+			}
+
+			// each tile renders all the elements
+			tst::check(tiled_stats.num_elements > single_stats.num_elements, SL);
+			tst::check_eq(tiled_stats.num_elements % single_stats.num_elements, size_t(0), SL);
+		}
+	);
+});
+}
@@ -0,0 +1,49 @@
+#include <tst/set.hpp>
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+#include "../../src/svgren/render.hpp"
+
+#include "util.hxx"
+
+namespace{
+// Shapes are rasterized at different offsets within the tile canvases, which can change
+// antialiasing coverage by rounding, but filter output must not leak out of the filter region.
+const unsigned tolerance = 2;
+
+const std::string data_dir = "samples_data/";
+}
+
+namespace{
+const tst::set set("tiled", [](tst::suite& suite){
+	auto files = list_svg_files(data_dir);
+
+	suite.add<std::string>(
+		"tiled_rasterization_matches_single_threaded",
+		files,
+		[](const auto& p){
+			auto dom = svgdom::load(fsif::native_file(data_dir + p));
+
+			svgren::prepared_document doc(*dom);
+
+			// Downscaled blur blocks are aligned to the filter region start, and the automatic blur
+			// algorithm choice depends on the region size, both of which differ between the tiles.
+			svgren::parameters params;
+			params.blur = svgren::blur_algorithm::box;
+			params.blur_downscaling = false;
+
+			auto expected = svgren::rasterize(doc, params);
+
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.num_threads = 4;
+			// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+			params.tile_dims = decltype(params.tile_dims){64, 32};
+
+			auto im = svgren::rasterize(doc, params);
+
+			check_close(expected, im, tolerance, p);
+		}
+	);
+});
+}
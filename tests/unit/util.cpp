@@ -0,0 +1,130 @@
+#include "util.hxx"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <regex>
+
+#include <tst/check.hpp>
+
+#include <fsif/native_file.hpp>
+
+svgren::image_type make_random_image(r4::vector2<unsigned> dims, unsigned seed){
+	svgren::image_type ret(dims);
+
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<unsigned> dist(0, 0xff); // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+
+	for(auto& px : ret.pixels()){
+		auto a = dist(gen);
+
+		// NOLINTNEXTLINE(cppcoreguidelines-avoid-magic-numbers)
+		switch(a % 8){
+			case 0:
+				a = 0;
+				break;
+			case 1:
+				a = 0xff; // NOLINT(cppcoreguidelines-avoid-magic-numbers)
+				break;
+			default:
+				break;
+		}
+
+		for(unsigned c = 0; c != 3; ++c){
+			px[c] = uint8_t(dist(gen) % (a + 1));
+		}
+		px.a() = uint8_t(a);
+	}
+
+	return ret;
+}
+
+std::string make_filter_document(std::string_view primitives, std::string_view primitive_units){
+	std::string ret = R"(
+		<svg xmlns="http://www.w3.org/2000/svg" width="96" height="80">
+			<filter id="f" filterUnits="userSpaceOnUse" x="0" y="0" width="96" height="80" primitiveUnits="UNITS">
+				PRIMITIVES
+			</filter>
+			<g filter="url(#f)">
+				<rect x="10" y="10" width="40" height="30" fill="red"/>
+				<circle cx="50" cy="40" r="25" fill="blue" fill-opacity="0.6"/>
+				<rect x="30" y="45" width="50" height="20" fill="yellow" fill-opacity="0.8"/>
+			</g>
+		</svg>
+	)";
+
+	auto replace = [&ret](std::string_view placeholder, std::string_view value){
+		ret.replace(ret.find(placeholder), placeholder.size(), value);
+	};
+
+	replace("UNITS", primitive_units);
+	replace("PRIMITIVES", primitives);
+
+	return ret;
+}
+
+std::vector<std::string> list_svg_files(const std::string& dir){
+	std::vector<std::string> files;
+
+	const std::regex suffix_regex("^.*\\.svg$");
+	auto all_files = fsif::native_file(dir).list_dir();
+
+	std::copy_if(
+			all_files.begin(),
+			all_files.end(),
+			std::back_inserter(files),
+			[&suffix_regex](auto& f){
+				return std::regex_match(f, suffix_regex);
+			}
+		);
+
+	return files;
+}
+
+namespace{
+bool is_close(const svgren::image_type::pixel_type& px1, const svgren::image_type::pixel_type& px2, unsigned tolerance){
+	for(size_t c = 0; c != px1.size(); ++c){
+		auto c1 = px1[c];
+		auto c2 = px2[c];
+		if(c1 > c2){
+			std::swap(c1, c2);
+		}
+		if(unsigned(c2 - c1) > tolerance){
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+void check_close(
+		const svgren::image_type& expected,
+		const svgren::image_type& actual,
+		unsigned tolerance,
+		const std::string& file
+	)
+{
+	tst::check_eq(actual.dims(), expected.dims(), SL) << "file = " << file;
+
+	for(size_t i = 0; i != expected.pixels().size(); ++i){
+		tst::check(is_close(expected.pixels()[i], actual.pixels()[i], tolerance), SL) << "pixel #" << i << " differs, file = " << file;
+	}
+}
+
+void check_close(
+		svgren::image_span_type::const_image_span_type expected,
+		svgren::image_span_type::const_image_span_type actual,
+		unsigned tolerance,
+		const std::string& file
+	)
+{
+	tst::check_eq(actual.dims(), expected.dims(), SL) << "file = " << file;
+
+	for(unsigned y = 0; y != expected.dims().y(); ++y){
+		auto expected_row = expected[y];
+		auto actual_row = actual[y];
+		for(unsigned x = 0; x != expected.dims().x(); ++x){
+			tst::check(is_close(expected_row[x], actual_row[x], tolerance), SL) << "pixel (" << x << ", " << y << ") differs, file = " << file;
+		}
+	}
+}
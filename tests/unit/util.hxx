@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../src/svgren/render.hpp"
+
+// image of random premultiplied pixels, every few pixels are fully transparent or fully opaque
+svgren::image_type make_random_image(r4::vector2<unsigned> dims, unsigned seed);
+
+// SVG document 96x80 with a group of shapes of different colors and opacities,
+// the filter of the group is made of the given filter primitives, the filter region is the whole image
+std::string make_filter_document(std::string_view primitives, std::string_view primitive_units = "userSpaceOnUse");
+
+// list SVG files in the directory
+std::vector<std::string> list_svg_files(const std::string& dir);
+
+// check that each channel of each pixel differs by no more than the tolerance
+void check_close(
+		const svgren::image_type& expected,
+		const svgren::image_type& actual,
+		unsigned tolerance,
+		const std::string& file
+	);
+
+// same as above, for image spans
+void check_close(
+		svgren::image_span_type::const_image_span_type expected,
+		svgren::image_span_type::const_image_span_type actual,
+		unsigned tolerance,
+		const std::string& file
+	);